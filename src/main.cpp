@@ -1,12 +1,16 @@
 #include <boost/mpi.hpp>
 
+#include "mpi/MPIDataSetFile.hpp"
 #include "mpi/MPISolver.hpp"
 #include "serial/SerialSolver.hpp"
+#include "shared/AssignmentKernel.hpp"
 #include "shared/DataSet.hpp"
+#include "shared/Partition.hpp"
 #include "shared/Logging.hpp"
 #include "shared/Point.hpp"
 #include "shared/Instrumentation.hpp"
 #include <boost/program_options.hpp>
+#include <filesystem>
 #include <ranges>
 #include "shared/Timer.hpp"
 #include "shared/DualOutputStream.hpp"
@@ -14,7 +18,8 @@
 
 int main(int argc, char **argv) {
     DEBUG_PRINT("Creating MPI Environment");
-    boost::mpi::environment mpiEnvironment(argc, argv);
+    // funneled, since the solvers may run worker threads, but only the main thread ever calls MPI
+    boost::mpi::environment mpiEnvironment(argc, argv, boost::mpi::threading::funneled);
     boost::mpi::communicator worldCommunicator;
 
     size_t maxIterations;
@@ -27,6 +32,31 @@ int main(int argc, char **argv) {
     bool printHeader;
     std::string filename;
     size_t numTrials;
+    std::string assignmentBackendName;
+    kmeans::AssignmentBackend assignmentBackend;
+    size_t yinyangGroupCount;
+    size_t miniBatchSize;
+    std::string initializationMethodName;
+    kmeans::InitializationMethod initializationMethod;
+    size_t numThreads;
+    size_t pipelineChunks;
+    std::string inputFileName;
+    std::string saveDataSetFileName;
+    bool nodeSharedMemory;
+    std::string reductionStrategyName;
+    kmeans::ReductionStrategy reductionStrategy;
+    double rebalanceThreshold;
+    bool shardedCentroids;
+    std::string checkpointFileName;
+    size_t checkpointInterval;
+    bool resume;
+    std::string traceFormatName;
+    // these only go to the profiler, so a build without it parses them and then has no use for them
+    [[maybe_unused]] instrumentation::TraceFormat traceFormat;
+    std::string profileModeName;
+    [[maybe_unused]] instrumentation::ProfileMode profileMode;
+    bool keepTraceShards;
+    bool perfCounters;
 
     try {
         boost::program_options::options_description desc("Allowed options");
@@ -41,7 +71,26 @@ int main(int argc, char **argv) {
                 ("print-header", boost::program_options::bool_switch(&printHeader), "Print the header for the output file")
                 ("filename", boost::program_options::value<std::string>(&filename)->default_value("output.csv"), "Filename to write output to")
                 ("convergence-threshold", boost::program_options::value<double>(&convergenceThreshold)->default_value(0.0001), "Threshold for convergence.")
-                ("trials", boost::program_options::value<size_t>(&numTrials)->default_value(10), "Number of trials to run");
+                ("trials", boost::program_options::value<size_t>(&numTrials)->default_value(10), "Number of trials to run")
+                ("assignment-backend", boost::program_options::value<std::string>(&assignmentBackendName)->default_value("per-point"), "How points are classed to centroids: per-point, blocked (tiled, for large k and d), elkan (per-centroid bounds), hamerly (single bounds, for low to medium d) or yinyang (grouped bounds, for large k)")
+                ("yinyang-groups", boost::program_options::value<size_t>(&yinyangGroupCount)->default_value(0), "Number of centroid groups for the yinyang backend. 0 picks clusters / 10")
+                ("mini-batch-size", boost::program_options::value<size_t>(&miniBatchSize)->default_value(0), "If non-zero, run mini-batch k-means, sampling this many points per rank per iteration. Approximate, but fast on huge datasets. Ignores --assignment-backend")
+                ("initialization", boost::program_options::value<std::string>(&initializationMethodName)->default_value("random"), "How the starting centroids are picked: random or kmeans++ (k-means|| across ranks)")
+                ("threads", boost::program_options::value<size_t>(&numThreads)->default_value(1), "Threads per process. 0 uses every hardware thread. With several threads, one rank per socket or node is enough")
+                ("pipeline-chunks", boost::program_options::value<size_t>(&pipelineChunks)->default_value(0), "If more than 1, class each rank's points in this many chunks and overlap each chunk's reduction with the next chunk. Each chunk is a flat all-reduce, so it can't be combined with --reduction hierarchical. MPI only")
+                ("input-file", boost::program_options::value<std::string>(&inputFileName)->default_value(""), "Load the dataset from this binary dataset file instead of generating one. --num-samples and --dimensions are then taken from the file. A weights column is ignored, the solvers don't use weights yet")
+                ("save-dataset", boost::program_options::value<std::string>(&saveDataSetFileName)->default_value(""), "Write the dataset to this binary dataset file before solving. Single process only")
+                ("node-shared-memory", boost::program_options::bool_switch(&nodeSharedMemory), "Put each rank's points in its own piece of one node-wide shared memory window, and send the starting centroids across the network once per node, through the window. Every rank still keeps private centroid copies, and no rank reads another's points, so this doesn't save memory. MPI only")
+                ("reduction", boost::program_options::value<std::string>(&reductionStrategyName)->default_value("flat"), "How the centroid sums are combined across ranks: flat (one all-reduce) or hierarchical (reduce per node, all-reduce between node leaders, then back to the node). MPI only")
+                ("rebalance-threshold", boost::program_options::value<double>(&rebalanceThreshold)->default_value(0.0), "If non-zero, move points from slow ranks to fast ones whenever the slowest rank takes more than this fraction longer than the mean to class its points, e.g. 0.1. MPI only")
+                ("sharded-centroids", boost::program_options::bool_switch(&shardedCentroids), "Split the centroids across the ranks and pass the points around a ring instead, for very large cluster counts. Ignores --assignment-backend, --mini-batch-size and --pipeline-chunks. MPI only")
+                ("checkpoint-file", boost::program_options::value<std::string>(&checkpointFileName)->default_value(""), "Where to write checkpoints to (with --checkpoint-interval), and resume from (with --resume)")
+                ("checkpoint-interval", boost::program_options::value<size_t>(&checkpointInterval)->default_value(0), "If non-zero, write a checkpoint every this many iterations, in the background")
+                ("resume", boost::program_options::bool_switch(&resume), "Carry on from the checkpoint in --checkpoint-file instead of picking starting centroids. Any number of processes can resume any checkpoint")
+                ("trace-format", boost::program_options::value<std::string>(&traceFormatName)->default_value("json"), "What a profiling build writes at the end: json (a Chrome trace, log.json) or binary (the raw records, log.trace, for kmeans_trace_to_json)")
+                ("profile-mode", boost::program_options::value<std::string>(&profileModeName)->default_value("trace"), "What a profiling build keeps: trace (every scope, see --trace-format) or aggregate (per scope call counts, times and histograms, merged across threads and processes, printed and written to profile.json)")
+                ("keep-trace-shards", boost::program_options::bool_switch(&keepTraceShards), "Leave each process's trace shard (log.json.<rank>.shard, or log.trace.<rank>.shard) as it is at the end, instead of merging them on rank 0. For when rank 0 can't see the other processes' files. Merge them with kmeans_trace_to_json")
+                ("perf-counters", boost::program_options::bool_switch(&perfCounters), "Read hardware counters (cycles, instructions, L1D, LLC and branch misses) around every profiled scope with perf_event_open, into the trace or the profile summary. Linux only, and carries on without them where they can't be opened. Costs two syscalls per scope");
 
         boost::program_options::command_line_parser parser{argc, argv};
         parser.options(desc).allow_unregistered().style(
@@ -58,10 +107,25 @@ int main(int argc, char **argv) {
             return 0;
         }
 
+        assignmentBackend = kmeans::parseAssignmentBackend(assignmentBackendName);
+        initializationMethod = kmeans::parseInitializationMethod(initializationMethodName);
+        reductionStrategy = kmeans::parseReductionStrategy(reductionStrategyName);
+        traceFormat = instrumentation::parseTraceFormat(traceFormatName);
+        profileMode = instrumentation::parseProfileMode(profileModeName);
+        if (pipelineChunks > 1 && reductionStrategy == kmeans::ReductionStrategy::Hierarchical) {
+            throw std::invalid_argument("--pipeline-chunks reduces every chunk with a flat all-reduce, so it can't be combined with --reduction hierarchical");
+        }
+        if (resume && checkpointFileName.empty()) {
+            throw std::invalid_argument("--resume needs a --checkpoint-file to resume from");
+        }
+
 
     } catch (const boost::program_options::error &e) {
         std::cerr << e.what() << std::endl;
         return 1;
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
 
     // Creating my DualStream
@@ -69,18 +133,24 @@ int main(int argc, char **argv) {
 
     // print the table header
     if (printHeader && worldCommunicator.rank() == 0) {
-        ds << "Number Processes," << "Number Samples," << "Number Dimensions," << "Number Clusters," << "Spread," << "Seed," << "Run Time (s)," << "Did Reach Convergence?," << "Iteration Count," << "Max Centroid Difference" << std::endl;
+        ds << "Number Processes," << "Number Samples," << "Number Dimensions," << "Number Clusters," << "Spread," << "Seed," << "Run Time (s)," << "Did Reach Convergence?," << "Iteration Count," << "Max Centroid Difference," << "Load Imbalance" << std::endl;
         return 0; // exit after writing the header
     }
 
-    auto writer = new instrumentation::MPIWriter(instrumentation::MPIWriter::Config{
-        "log.json",
-        0,
-        5020,
-        0
-    });
-
-    PROFILE_BEGIN_SESSION(std::unique_ptr<instrumentation::MPIWriter>(writer));
+    // the writer is built inside the macro, so a build without profiling never makes one. It dups the world
+    // communicator, and only the session frees that again
+    PROFILE_BEGIN_SESSION_WITH_CONFIG(
+        std::make_unique<instrumentation::MPIWriter>(instrumentation::MPIWriter::Config{
+            traceFormat == instrumentation::TraceFormat::Binary ? "log.trace" : "log.json",
+            0,
+            5020,
+            0,
+            traceFormat,
+            "profile.json",
+            keepTraceShards
+        }),
+        (instrumentation::Instrumentor::Config{profileMode, perfCounters})
+    );
 
     // we'll create our dataset no matter what
     // in a child scope so we can dump all associated data quickly
@@ -113,12 +183,50 @@ int main(int argc, char **argv) {
             subSeedGenerator(generator)
         };
 
-        dataSet = kmeans::DataSet(datasetConfig);
+        // with one process, that's the whole dataset. With more, every rank generates only the shard it will work on,
+        // so there is nothing to scatter, and no rank ever holds more than its own share
+        // A file is just mapped by a single process. With more, every rank reads its own slice of it with MPI-IO.
+        if (!inputFileName.empty()) {
+            try {
+                if (worldCommunicator.size() == 1) {
+                    dataSet = kmeans::DataSet(std::filesystem::path(inputFileName));
+                } else {
+                    dataSet = kmeans::readDataSetFileSlice(inputFileName, worldCommunicator);
+                }
+            } catch (const std::runtime_error &e) {
+                std::cerr << e.what() << std::endl;
+                mpiEnvironment.abort(1);
+            }
+            // the csv wants the size of the whole file, not of our slice
+            numGeneratedSamples = boost::mpi::all_reduce(worldCommunicator, dataSet.size(), std::plus<>());
+            numDimensions = dataSet.numDimensions();
+        } else if (worldCommunicator.size() == 1) {
+            dataSet = kmeans::DataSet(datasetConfig);
+        } else {
+            const kmeans::RowPartition shard = kmeans::partitionRows(numGeneratedSamples, worldCommunicator.size(), worldCommunicator.rank());
+            dataSet = kmeans::DataSet(datasetConfig, shard.begin, shard.count);
+        }
+
+    }
 
+    if (!saveDataSetFileName.empty()) {
+        if (worldCommunicator.size() == 1) {
+            dataSet.writeToFile(saveDataSetFileName);
+        } else if (worldCommunicator.rank() == 0) {
+            std::cerr << "--save-dataset needs a single process, since every rank only holds its own shard. Ignoring it" << std::endl;
+        }
     }
 
+    // a dataset from a file has no known good centroids to compare against
+    const auto maxCentroidDifference = [&dataSet](const std::vector<kmeans::Point> &calculatedCentroids) {
+        if (!dataSet.getKnownGoodCentroids().has_value()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return kmeans::getMaxCentroidDifference(calculatedCentroids, dataSet.getKnownGoodCentroids().value());
+    };
+
     if constexpr (DEBUG_FLAG) {
-        if (worldCommunicator.rank() == 0) {
+        if (worldCommunicator.rank() == 0 && dataSet.getKnownGoodCentroids().has_value()) {
             // if we are the main rank, print all centroids
             std::cout << "Known Good Centroids:" << std::endl;
             std::ranges::for_each(
@@ -132,6 +240,11 @@ int main(int argc, char **argv) {
 
     uint64_t runRandom = subSeedGenerator(generator);
 
+    // the kernels are picked at compile time, so say which ones this binary got. It goes to the console, not the csv
+    if (worldCommunicator.rank() == 0) {
+        std::cout << "Assignment kernels: " << kmeans::kernel::getInstructionSetName() << std::endl;
+    }
+
     for (size_t trial = 0; trial < numTrials; ++trial) {
         // now that we have our dataset, we can actually go to the correct function.
         // note, we are implicitly going to be calling our serial code when world size is one
@@ -144,7 +257,15 @@ int main(int argc, char **argv) {
                 convergenceThreshold,
                 kmeans::DataSet(dataSet.getPoints()),
                 runRandom,
-                numTrueClusters
+                numTrueClusters,
+                assignmentBackend,
+                yinyangGroupCount,
+                miniBatchSize,
+                initializationMethod,
+                numThreads,
+                checkpointFileName,
+                checkpointInterval,
+                resume
             );
 
             // create the solver
@@ -166,7 +287,8 @@ int main(int argc, char **argv) {
                     << time.getTimeSecondsDouble() << ','
                     << ((maxIterations == solver.getFinalIterationCount()) ? "no" : "yes") << ','
                     << solver.getFinalIterationCount().value_or(0) << ','
-                    << kmeans::getMaxCentroidDifference(solver.getCalculatedCentroidsAtCompletion().value(), dataSet.getKnownGoodCentroids().value()) << std::endl;;
+                    << maxCentroidDifference(solver.getCalculatedCentroidsAtCompletion().value()) << ','
+                    << 1.0 << std::endl; // one process is always balanced
             }
 
             if constexpr (DEBUG_FLAG) {
@@ -193,6 +315,21 @@ int main(int argc, char **argv) {
                 0,
                 2550
             );
+            config.assignmentBackend = assignmentBackend;
+            config.yinyangGroupCount = yinyangGroupCount;
+            config.miniBatchSize = miniBatchSize;
+            config.initializationMethod = initializationMethod;
+            config.numThreads = numThreads;
+            config.pipelineChunks = pipelineChunks;
+            // generated and file datasets alike are already sharded, so there is nothing to scatter
+            config.dataSetIsDistributed = true;
+            config.nodeSharedMemory = nodeSharedMemory;
+            config.reductionStrategy = reductionStrategy;
+            config.rebalanceThreshold = rebalanceThreshold;
+            config.shardedCentroids = shardedCentroids;
+            config.checkpointPath = checkpointFileName;
+            config.checkpointInterval = checkpointInterval;
+            config.resume = resume;
             kmeans::MPISolver solver(std::move(config), worldCommunicator);
 
             auto time = timer::time([&solver] {
@@ -209,7 +346,23 @@ int main(int argc, char **argv) {
                     << time.getTimeSecondsDouble() << ','
                     << ((maxIterations == solver.getFinalIterationCount()) ? "no" : "yes") << ','
                     << solver.getFinalIterationCount().value_or(0) << ','
-                    << kmeans::getMaxCentroidDifference(solver.getCalculatedCentroidsAtCompletion().value(), dataSet.getKnownGoodCentroids().value()) << std::endl;
+                    << maxCentroidDifference(solver.getCalculatedCentroidsAtCompletion().value()) << ','
+                    << solver.getLoadImbalance() << std::endl;
+            }
+
+            // the time spent in blocking reductions, so the strategies can be compared, and the pipelined reductions
+            // report how much of their time was overlapped. This goes to the console only, so the csv keeps its columns
+            if (worldCommunicator.rank() == 0) {
+                std::cout << "Centroid reduction on rank 0 (" << kmeans::getReductionStrategyName(reductionStrategy) << "): "
+                          << solver.getReductionTime() << "s" << std::endl;
+            }
+            if (rebalanceThreshold > 0.0 && worldCommunicator.rank() == 0) {
+                std::cout << "Repartitioned the points " << solver.getRebalanceCount() << " times" << std::endl;
+            }
+            if (pipelineChunks > 1 && worldCommunicator.rank() == 0) {
+                std::cout << "Pipelined communication on rank 0: "
+                          << solver.getHiddenCommunicationTime() << "s hidden, "
+                          << solver.getExposedCommunicationTime() << "s exposed" << std::endl;
             }
 
             if constexpr (DEBUG_FLAG) {
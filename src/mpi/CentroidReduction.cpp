@@ -0,0 +1,97 @@
+//
+// Created by Matthew Krueger on 11/7/25.
+//
+
+#include "CentroidReduction.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../shared/Instrumentation.hpp"
+
+namespace kmeans {
+
+    ReductionStrategy parseReductionStrategy(const std::string &name) {
+        if (name == "flat") {
+            return ReductionStrategy::Flat;
+        }
+        if (name == "hierarchical") {
+            return ReductionStrategy::Hierarchical;
+        }
+        throw std::invalid_argument("Unknown reduction strategy: " + name);
+    }
+
+    const char* getReductionStrategyName(const ReductionStrategy strategy) {
+        switch (strategy) {
+            case ReductionStrategy::Flat: return "flat";
+            case ReductionStrategy::Hierarchical: return "hierarchical";
+        }
+        return "unknown";
+    }
+
+    std::unique_ptr<CentroidReducer> CentroidReducer::create(const ReductionStrategy strategy, MPI_Comm communicator, const NodeTopology* topology, const SharedWindow* nodeCopy) {
+        switch (strategy) {
+            case ReductionStrategy::Flat: return std::make_unique<FlatCentroidReducer>(communicator);
+            case ReductionStrategy::Hierarchical:
+                if (topology == nullptr) {
+                    throw std::invalid_argument("The hierarchical reduction needs the node topology");
+                }
+                return std::make_unique<HierarchicalCentroidReducer>(*topology, nodeCopy);
+        }
+        throw std::invalid_argument("Unknown reduction strategy");
+    }
+
+    void CentroidReducer::reduce(double* buffer, const size_t count) {
+        PROFILE_FUNCTION();
+
+        const double start = MPI_Wtime();
+        reduceImpl(buffer, count);
+        m_ReductionTime += MPI_Wtime() - start;
+    }
+
+    void FlatCentroidReducer::reduceImpl(double* buffer, const size_t count) {
+        // the sums and the counts already sit in one contiguous block of doubles, so this is a single native
+        // MPI_SUM, in place. No serialization, no temporaries, and MPI is free to pick its fastest algorithm.
+        MPI_Allreduce(MPI_IN_PLACE, buffer, static_cast<int>(count), MPI_DOUBLE, MPI_SUM, m_Communicator);
+    }
+
+    void HierarchicalCentroidReducer::reduceImpl(double* buffer, const size_t count) {
+        const int intCount = static_cast<int>(count);
+        MPI_Comm node = m_Topology.nodeCommunicator();
+
+        // first, within the node. That is all shared memory, so it never touches the interconnect
+        {
+            PROFILE_SCOPE("Node reduce");
+            if (m_Topology.isLeader()) {
+                MPI_Reduce(MPI_IN_PLACE, buffer, intCount, MPI_DOUBLE, MPI_SUM, 0, node);
+            } else {
+                MPI_Reduce(buffer, nullptr, intCount, MPI_DOUBLE, MPI_SUM, 0, node);
+            }
+        }
+
+        // then between the nodes, one rank each
+        if (m_Topology.isLeader() && m_Topology.numNodes() > 1) {
+            PROFILE_SCOPE("Leader all-reduce");
+            MPI_Allreduce(MPI_IN_PLACE, buffer, intCount, MPI_DOUBLE, MPI_SUM, m_Topology.leaderCommunicator());
+        }
+
+        // and back to the rest of the node. The leader only writes the shared copy once the node reduce has finished,
+        // and that can't happen until every rank on the node is done reading the last one, so it needs just the one fence
+        {
+            PROFILE_SCOPE("Node hand back");
+            if (m_NodeCopy != nullptr && m_NodeCopy->sizeOf(0) >= count * sizeof(double)) {
+                auto* shared = reinterpret_cast<double*>(m_NodeCopy->of(0));
+                if (m_Topology.isLeader()) {
+                    std::copy_n(buffer, count, shared);
+                }
+                m_NodeCopy->synchronize();
+                if (!m_Topology.isLeader()) {
+                    std::copy_n(shared, count, buffer);
+                }
+            } else {
+                MPI_Bcast(buffer, intCount, MPI_DOUBLE, 0, node);
+            }
+        }
+    }
+
+} // kmeans
@@ -0,0 +1,118 @@
+//
+// Created by Matthew Krueger on 11/7/25.
+//
+
+#ifndef KMEANS_MPI_CENTROIDREDUCTION_HPP
+#define KMEANS_MPI_CENTROIDREDUCTION_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <mpi.h>
+
+#include "NodeTopology.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief Selects how the per-rank centroid sums are combined into the global sums every iteration.
+     */
+    enum class ReductionStrategy {
+        /// One MPI_Allreduce over every rank. Best with few ranks per node.
+        Flat,
+        /// Reduce within each node, all-reduce between one leader per node, then hand the result back to the node.
+        /// Only one rank per node touches the interconnect, so best with many ranks per node and large k * d.
+        Hierarchical
+    };
+
+    /**
+     * @brief Parses a strategy from its command line name.
+     * @param name Either "flat" or "hierarchical"
+     * @return The strategy
+     * @throws std::invalid_argument if the name is not recognized
+     */
+    ReductionStrategy parseReductionStrategy(const std::string& name);
+
+    /**
+     * @brief Gets the command line name of a strategy.
+     */
+    const char* getReductionStrategyName(ReductionStrategy strategy);
+
+    /**
+     * @brief Sums a block of doubles across every rank, in place, so every rank ends up with the global sum.
+     *
+     * The solvers call it with the whole [coordinates][counts] block of their centroid accumulator, so how the
+     * reduction is routed can be swapped without the solver knowing.
+     */
+    class CentroidReducer {
+    public:
+        CentroidReducer() = default;
+        CentroidReducer(const CentroidReducer&) = delete;
+        CentroidReducer& operator=(const CentroidReducer&) = delete;
+        virtual ~CentroidReducer() = default;
+
+        /**
+         * @brief Reduces, in place. Collective.
+         * @param buffer This rank's values in, the global sums out
+         * @param count The number of doubles. Must be the same on every rank.
+         */
+        void reduce(double* buffer, size_t count);
+
+        /**
+         * @brief Gets the time, in seconds, this rank has spent in reduce().
+         */
+        [[nodiscard]] inline double getReductionTime() const { return m_ReductionTime; }
+
+        /**
+         * @brief Creates a reducer.
+         * @param strategy Which one to create
+         * @param communicator Every rank taking part
+         * @param topology The node layout of communicator. Required for Hierarchical, ignored by Flat.
+         * @param nodeCopy If not null, the node's shared copy of the centroids (in the leader's piece). Hierarchical
+         * then hands the result back through it instead of broadcasting it. Ignored by Flat.
+         * @throws std::invalid_argument if Hierarchical is asked for without a topology
+         */
+        static std::unique_ptr<CentroidReducer> create(ReductionStrategy strategy, MPI_Comm communicator, const NodeTopology* topology, const SharedWindow* nodeCopy);
+
+    protected:
+        virtual void reduceImpl(double* buffer, size_t count) = 0;
+
+    private:
+        double m_ReductionTime = 0.0;
+    };
+
+    /**
+     * @brief One native in-place MPI_Allreduce.
+     */
+    class FlatCentroidReducer final : public CentroidReducer {
+    public:
+        explicit FlatCentroidReducer(MPI_Comm communicator) : m_Communicator(communicator) {}
+
+    protected:
+        void reduceImpl(double* buffer, size_t count) override;
+
+    private:
+        MPI_Comm m_Communicator;
+    };
+
+    /**
+     * @brief Node reduce to the leader, all-reduce among the leaders, and back to the node.
+     *
+     * The way back is an MPI_Bcast over the node, unless the node has a shared copy of the centroids that is big enough,
+     * in which case the leader writes the result into it once, and the rest of the node just reads it.
+     */
+    class HierarchicalCentroidReducer final : public CentroidReducer {
+    public:
+        HierarchicalCentroidReducer(const NodeTopology& topology, const SharedWindow* nodeCopy) : m_Topology(topology), m_NodeCopy(nodeCopy) {}
+
+    protected:
+        void reduceImpl(double* buffer, size_t count) override;
+
+    private:
+        const NodeTopology& m_Topology;
+        const SharedWindow* m_NodeCopy;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_CENTROIDREDUCTION_HPP
@@ -0,0 +1,88 @@
+//
+// Created by Matthew Krueger on 11/5/25.
+//
+
+#include "MPIDataSetFile.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <mpi.h>
+
+#include "../shared/DataSetFile.hpp"
+#include "../shared/Instrumentation.hpp"
+#include "../shared/Logging.hpp"
+#include "../shared/Partition.hpp"
+
+namespace kmeans {
+
+    namespace {
+        // files default to MPI_ERRORS_RETURN, so every call has to be checked by hand
+        void checkFileCall(const int result, const std::string &what, const std::filesystem::path &path) {
+            if (result != MPI_SUCCESS) {
+                char message[MPI_MAX_ERROR_STRING];
+                int length = 0;
+                MPI_Error_string(result, message, &length);
+                throw std::runtime_error("Cannot " + what + " " + path.string() + ": " + std::string(message, length));
+            }
+        }
+
+        // read count elements of type at offset, collectively, straight into buffer
+        void readAtAll(MPI_File file, const MPI_Offset offset, void* buffer, const size_t count, MPI_Datatype type, const std::filesystem::path &path) {
+            MPI_Status status;
+            checkFileCall(MPI_File_read_at_all(file, offset, buffer, static_cast<int>(count), type, &status), "read", path);
+
+            int received = 0;
+            MPI_Get_count(&status, type, &received);
+            if (static_cast<size_t>(received) != count) {
+                throw std::runtime_error("Short read from " + path.string());
+            }
+        }
+    }
+
+    DataSet readDataSetFileSlice(const std::filesystem::path &path, const boost::mpi::communicator &communicator) {
+        PROFILE_FUNCTION();
+
+        MPI_File file;
+        checkFileCall(MPI_File_open(communicator, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file), "open", path);
+
+        PointMatrix points;
+        try {
+            // the header is tiny, so everybody just reads it, and everybody validates it the same way
+            DataSetFileHeader header{};
+            MPI_Offset fileSize = 0;
+            {
+                PROFILE_SCOPE("Reading header");
+                checkFileCall(MPI_File_get_size(file, &fileSize), "stat", path);
+                if (static_cast<uint64_t>(fileSize) < sizeof(DataSetFileHeader)) {
+                    throw std::runtime_error(path.string() + " is too small to be a dataset file");
+                }
+                readAtAll(file, 0, &header, sizeof(header), MPI_BYTE, path);
+                header.validate(static_cast<uint64_t>(fileSize));
+            }
+
+            const size_t numDimensions = header.numDimensions;
+            const RowPartition myPartition = partitionRows(header.numPoints, static_cast<size_t>(communicator.size()), static_cast<size_t>(communicator.rank()));
+            DEBUG_PRINT("Rank " << communicator.rank() << ". Reading " << myPartition.count << " points from " << myPartition.begin);
+
+            // same as the scatter, one point is one element, so the int count is in points rather than doubles
+            MPI_Datatype rowType;
+            MPI_Type_contiguous(static_cast<int>(numDimensions), MPI_DOUBLE, &rowType);
+            MPI_Type_commit(&rowType);
+
+            points = PointMatrix(myPartition.count, numDimensions);
+            {
+                PROFILE_SCOPE("Reading points");
+                const auto offset = static_cast<MPI_Offset>(header.dataOffset + myPartition.begin * numDimensions * sizeof(double));
+                readAtAll(file, offset, points.data(), myPartition.count, rowType, path);
+            }
+            MPI_Type_free(&rowType);
+        } catch (...) {
+            MPI_File_close(&file);
+            throw;
+        }
+
+        MPI_File_close(&file);
+        return DataSet(std::move(points));
+    }
+
+} // kmeans
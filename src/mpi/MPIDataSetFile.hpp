@@ -0,0 +1,33 @@
+//
+// Created by Matthew Krueger on 11/5/25.
+//
+
+#ifndef KMEANS_MPI_MPIDATASETFILE_HPP
+#define KMEANS_MPI_MPIDATASETFILE_HPP
+
+#include <filesystem>
+#include <boost/mpi/communicator.hpp>
+
+#include "../shared/DataSet.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief Reads just this rank's slice of a dataset file (see DataSetFile.hpp) with collective MPI-IO.
+     *
+     * Every rank works out its own rows with partitionRows(), exactly the split initialDistributeDataSet() would have
+     * scattered, and reads that byte range straight into its local storage with MPI_File_read_at_all. The whole dataset
+     * is never on one rank, so the main rank's memory no longer caps the dataset size, and the read bandwidth grows with
+     * the number of ranks. The result can be handed to the MPISolver with dataSetIsDistributed set.
+     *
+     * Collective: every rank in the communicator must call it with the same path.
+     * @param path The file to read
+     * @param communicator The ranks to split the file across
+     * @return This rank's rows. A weights column isn't read, since none of the solvers use weights yet.
+     * @throws std::runtime_error if the file can't be read, or isn't a valid dataset file
+     */
+    DataSet readDataSetFileSlice(const std::filesystem::path& path, const boost::mpi::communicator& communicator);
+
+} // kmeans
+
+#endif //KMEANS_MPI_MPIDATASETFILE_HPP
@@ -0,0 +1,17 @@
+//
+// Created by Matthew Krueger on 10/27/25.
+//
+
+#include "MPIElkanSolver.hpp"
+
+namespace kmeans {
+
+    MPIElkanSolver::MPIElkanSolver(Config &&config, boost::mpi::communicator &communicator)
+        : MPISolver(useElkanBackend(std::move(config)), communicator) {}
+
+    MPISolver::Config &&MPIElkanSolver::useElkanBackend(Config &&config) {
+        config.assignmentBackend = AssignmentBackend::Elkan;
+        return std::move(config);
+    }
+
+} // kmeans
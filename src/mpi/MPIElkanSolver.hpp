@@ -0,0 +1,29 @@
+//
+// Created by Matthew Krueger on 10/27/25.
+//
+
+#ifndef KMEANS_MPI_MPIELKANSOLVER_HPP
+#define KMEANS_MPI_MPIELKANSOLVER_HPP
+
+#include "MPISolver.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief An MPISolver that always uses Elkan's triangle inequality accelerated assignment.
+     *
+     * Each rank keeps the bounds for its own slice of the dataset only, so the bounds never cross the network; the
+     * centroid reduction is exactly the MPISolver one. This is equivalent to constructing an MPISolver with
+     * assignmentBackend = AssignmentBackend::Elkan.
+     */
+    class MPIElkanSolver : public MPISolver {
+    public:
+        explicit MPIElkanSolver(Config &&config, boost::mpi::communicator& communicator);
+
+    private:
+        static Config&& useElkanBackend(Config &&config);
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_MPIELKANSOLVER_HPP
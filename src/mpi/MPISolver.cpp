@@ -4,51 +4,61 @@
 
 #include "MPISolver.hpp"
 #include <algorithm>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
 #include <unordered_set>
 #include <boost/mpi/communicator.hpp>
 #include <boost/mpi/collectives.hpp>
 #include <ranges>
+#include <boost/serialization/string.hpp>
 #include <boost/serialization/vector.hpp>
 #include "../shared/Logging.hpp"
+#include "../shared/MiniBatch.hpp"
 #include <boost/mpi/operations.hpp>
 
+#include "../shared/AssignmentKernel.hpp"
+#include "../shared/Partition.hpp"
 #include "../shared/Utils.hpp"
 
 namespace kmeans {
 
-    struct AddPointsFuctor {
-
-        std::vector<Point> operator()(const std::vector<Point>& a, const std::vector<Point>& b) const {
-            std::vector<Point> finalResult;
-            finalResult.reserve(a.size());
-            std::ranges::transform(a, b, std::back_inserter(finalResult), [&](const Point& left, const Point& right) {
-                Point result = left + right;
-                result.setCount(left.getCount() + right.getCount());
-                return result;
-            });
-            return finalResult;
-
-        }
-
-    };
-
     MPISolver::MPISolver(Config &&config, boost::mpi::communicator &communicator) : m_Communicator(communicator) {
         PROFILE_FUNCTION();
 
         DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Creating Solver from config");
-        m_CurrentCentroids = std::vector<Point>();
-        m_CurrentCentroids.reserve(config.startingCentroidCount); // reserve the right number of centroids
-        m_PreviousCentroids = std::vector<Point>(); // need not reserve since it will get dumped anyway
         m_MaxIterations = config.maxIterations;
         m_ConvergenceThreshold = config.convergenceThreshold;
         m_MainRank = config.mainRank;
         m_WorkingTag = config.workingTag;
+        m_AssignmentBackend = config.assignmentBackend;
+        m_YinyangGroupCount = config.yinyangGroupCount;
+        m_AssignmentEngine = AssignmentEngine::create(m_AssignmentBackend, m_YinyangGroupCount);
+        m_RebalanceThreshold = config.rebalanceThreshold;
+        m_NodeSharedMemory = config.nodeSharedMemory;
+        m_ShardedCentroids = config.shardedCentroids;
+        m_ThreadPool = std::make_unique<ThreadPool>(config.numThreads);
+        m_PipelineChunks = config.pipelineChunks;
+        if (m_PipelineChunks > 1 && config.reductionStrategy == ReductionStrategy::Hierarchical) {
+            throw std::invalid_argument("Pipelined reductions are always flat, so they can't be used with the hierarchical reduction");
+        }
+        m_MiniBatchSize = config.miniBatchSize;
+        // every rank gets its own stream, otherwise they would all sample the same local row indices
+        m_MiniBatchRng.seed(config.startingCentroidSeed + 1 + static_cast<size_t>(m_Communicator.rank()));
 
         DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Finished creating solver from config. Configuring");
 
         // before we distribute the dataset, we'll get the random points to make our centroids on the main rank only
-        if (m_Communicator.rank() == m_MainRank) {
+        // k-means|| needs every rank's points, so that one has to wait until after the distribution
+        // If every rank already holds just its own shard, there is nothing to distribute, and the random points have
+        // to be picked across the shards instead
+        const bool scalableInitialization = config.initializationMethod == InitializationMethod::KMeansPlusPlus;
+        const bool dataSetIsDistributed = config.dataSetIsDistributed;
+        if (!config.resume && !scalableInitialization && !dataSetIsDistributed && m_Communicator.rank() == m_MainRank) {
             DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Creating initial centroids from dataset");
+            m_CurrentCentroids = CentroidMatrix(config.startingCentroidCount, config.dataSet.numDimensions());
+
             // first, create our RNG
             std::mt19937 rng(config.startingCentroidSeed);
             std::uniform_int_distribution<size_t> dist(0, config.dataSet.size() - 1);
@@ -61,18 +71,57 @@ namespace kmeans {
                 indices.emplace(index);
             }
 
-            // then copy by value
-            std::ranges::transform(indices,
-                                   std::back_inserter(m_CurrentCentroids),
-                                   [&](const size_t index) { return Point(config.dataSet[index]); }
-                                   // explicitly copy the data so we know *FOR SURE* it's unique.
-            );
+            // then copy by value into the centroid rows
+            size_t centroid = 0;
+            for (const size_t index : indices) {
+                std::ranges::copy(config.dataSet[index], m_CurrentCentroids.row(centroid));
+                m_CurrentCentroids.setCount(centroid, 1.0);
+                ++centroid;
+            }
         }
 
         // now that we have our centroids, we can distribute our centroids.
         // we are sending an rValue so that we don't copy dataset
-        initialDistributeDataSet(std::move(config.dataSet));
-        initialDistributeCentroids();
+        // The dataset goes first, since that is how the worker ranks learn the dimensionality they need to size the centroids
+        if (dataSetIsDistributed) {
+            m_LocalDataSet = std::move(config.dataSet);
+        } else {
+            initialDistributeDataSet(std::move(config.dataSet));
+        }
+        if (config.nodeSharedMemory || config.reductionStrategy == ReductionStrategy::Hierarchical) {
+            // with a topology, the centroids go out through the node windows, from rank 0 of the leaders, which only
+            // the main rank's data is in if it is rank 0
+            if (m_MainRank != 0) {
+                throw std::invalid_argument("Node shared memory and the hierarchical reduction need the main rank to be rank 0");
+            }
+            m_NodeTopology = std::make_unique<NodeTopology>(m_Communicator);
+        }
+        if (config.nodeSharedMemory) {
+            moveDataSetToNodeWindow();
+        }
+        if (config.resume) {
+            resumeFromCheckpoint(config.checkpointPath, config.startingCentroidCount, config.startingCentroidSeed);
+        } else if (scalableInitialization) {
+            initializeCentroidsScalable(config.startingCentroidCount, config.startingCentroidSeed);
+        } else if (dataSetIsDistributed) {
+            initializeCentroidsFromShards(config.startingCentroidCount, config.startingCentroidSeed);
+        }
+        if (m_ShardedCentroids) {
+            initialDistributeCentroidShards(config.startingCentroidCount);
+        } else {
+            initialDistributeCentroids(config.startingCentroidCount);
+        }
+
+        m_CheckpointInterval = (config.checkpointPath.empty()) ? 0 : config.checkpointInterval;
+        if (m_CheckpointInterval > 0 && m_Communicator.rank() == m_MainRank) {
+            m_CheckpointWriter = std::make_unique<AsyncCheckpointWriter>(config.checkpointPath);
+        }
+
+        // the node's centroid copy only exists once the centroids have been distributed, so the reducer comes after
+        m_CentroidReducer = CentroidReducer::create(config.reductionStrategy, m_Communicator, m_NodeTopology.get(), m_NodeCentroids.get());
+
+        // the previous centroids are just the other half of a double buffer, so they need the same shape
+        m_PreviousCentroids = CentroidMatrix(m_CurrentCentroids.numCentroids(), m_CurrentCentroids.numDimensions());
 
         // now, every rank should have its own unique dataset, and we should be good
     }
@@ -80,11 +129,20 @@ namespace kmeans {
     void MPISolver::run() {
         PROFILE_FUNCTION();
 
+        if (m_ShardedCentroids) {
+            runSharded();
+            return;
+        }
+        if (m_MiniBatchSize > 0) {
+            runMiniBatch();
+            return;
+        }
+
         DEBUG_PRINT("Rank " << m_Communicator.rank() << " - Starting Centroid Count: " << m_CurrentCentroids.size());
         DEBUG_PRINT("Rank " << m_Communicator.rank() << " - m_LocalDataSet Size: " << m_LocalDataSet.size());
 
 
-        size_t iteration = 0;
+        size_t iteration = m_StartIteration;
         while (iteration < m_MaxIterations) { // test if we have reached convergence or max samples
 
             // in each iteration, we have to class the centroid, then accumulate the centroid to the new average.
@@ -92,51 +150,46 @@ namespace kmeans {
 
             // like serial code, it is most efficent to class and accumulate in one action
 
-            // first step is to move the current centroids to the previous
-            m_PreviousCentroids = std::move(m_CurrentCentroids);
+            // first step is to swap the current centroids into the previous. Both buffers live for the whole run.
+            std::swap(m_PreviousCentroids, m_CurrentCentroids);
 
-            // and zero the new one AND
-            // since m_CurrentCentroids has counts, we can fill the vector with zero
-            //m_CurrentCentroids = std::vector<Point>(m_PreviousCentroids.size(), Point(std::vector<double>(m_DataSet[0].numDimensions(), 0.0), 0));
+            // and zero the new one, sums and counts alike
+            m_CurrentCentroids.zero();
 
             // now that we have that, we can now accumulate
-            // again, this uses move semantics to pass the *same* value back and forth,
-            // so the accumulation is a zero cost abstraction that matches the reduction pattern more closely
-            // than "just" a for loop
+            // the local dataset is one contiguous row-major matrix, so this walks memory linearly, point after point
             // echo for stuff
             DEBUG_PRINT("BEFORE ACCUMULATE\n" <<
                         "Rank " << m_Communicator.rank() << " has " << m_CurrentCentroids.size() << " centroids"
                 <<"\n\t has " << m_LocalDataSet.size() << " points"
                 <<"\n\t has " << m_PreviousCentroids.size() << " previous centroids");
-            m_CurrentCentroids = std::accumulate(
-                m_LocalDataSet.begin(),
-                m_LocalDataSet.end(),
-                std::vector<Point>(m_PreviousCentroids.size(),
-                                   Point(std::vector<double>(m_PreviousCentroids[0].numDimensions(), 0.0), 0)),
-                [&](std::vector<Point> acc, Point &point) {
-                    PROFILE_SCOPE("Accumulate");
-                    auto closestCentroidInPrevious = point.findClosestPointInVector(m_PreviousCentroids); // class to previous
-
-                    if (closestCentroidInPrevious != m_PreviousCentroids.end()) {
-                        size_t centroidIndex = std::distance(m_PreviousCentroids.begin(), closestCentroidInPrevious);
-                        acc[centroidIndex] += point;
-                        acc[centroidIndex].setCount(acc[centroidIndex].getCount() + 1);
-                        return acc;
-                    } else {
-                        throw std::runtime_error("Centroid not found in previous centroids");
-                    }
-                }
-            );
-
-            // now, our m_CurrentCentroids contains our *LOCAL* sum.
-            // we need to sync them through an allreduce
-            // and then we can divide them by the scalar.
-            // echo for stuff
-            DEBUG_PRINT("BEFORE GLOBAL REDUCTION" << std::endl <<
-                        "Rank " << m_Communicator.rank() << " has " << m_CurrentCentroids.size() << " centroids"
-                <<"\n\t has " << m_LocalDataSet.size() << " points"
-                <<"\n\t has " << m_PreviousCentroids.size() << " previous centroids");
-            globalReduceCentroids();
+            // the assignment engine classes every local point against the previous centroids (class to previous) and adds
+            // it to the local sums. The rows are split across this rank's threads, and the per-thread sums are combined
+            // here, so the all-reduce below only ever sees one contribution per rank, however many cores it has
+            // the time spent classing is timed on its own, without the reduction, since that is the part that depends
+            // on how many points (and how fast a core) a rank has
+            double localAssignmentTime = 0.0;
+            if (m_PipelineChunks > 1) {
+                // classing and reducing are interleaved, chunk by chunk, so most of the reduction hides behind the classing
+                const double exposedBefore = m_ExposedCommunicationTime;
+                const double assignStart = MPI_Wtime();
+                assignAndReducePipelined();
+                localAssignmentTime = MPI_Wtime() - assignStart - (m_ExposedCommunicationTime - exposedBefore);
+            } else {
+                const double assignStart = MPI_Wtime();
+                assignAcrossThreads(*m_AssignmentEngine, *m_ThreadPool, m_LocalDataSet.getPoints(), m_PreviousCentroids, m_ThreadSums, m_CurrentCentroids);
+                localAssignmentTime = MPI_Wtime() - assignStart;
+
+                // now, our m_CurrentCentroids contains our *LOCAL* sum.
+                // we need to sync them through an allreduce
+                // and then we can divide them by the scalar.
+                // echo for stuff
+                DEBUG_PRINT("BEFORE GLOBAL REDUCTION" << std::endl <<
+                            "Rank " << m_Communicator.rank() << " has " << m_CurrentCentroids.size() << " centroids"
+                    <<"\n\t has " << m_LocalDataSet.size() << " points"
+                    <<"\n\t has " << m_PreviousCentroids.size() << " previous centroids");
+                globalReduceCentroids();
+            }
 
             // echo for stuff
             DEBUG_PRINT("BEFORE SCALAR\n" <<
@@ -144,13 +197,9 @@ namespace kmeans {
                 <<"\n\t has " << m_LocalDataSet.size() << " points"
                 <<"\n\t has " << m_PreviousCentroids.size() << " previous centroids");
 
-            std::ranges::for_each(m_CurrentCentroids, [](Point &centroid) {
-                if (centroid.getCount() > 0) {
-                    centroid /= static_cast<double>(centroid.getCount());
-                    centroid.setCount(1); // we need to set the count back to one
-                }
-                // If getCount() is 0, the centroid sum is already {0,0,...}, which is correct for an empty cluster.
-            });
+            // divide by the counts, and set the counts back to one
+            // If a count is 0, the centroid sum is already {0,0,...}, which is correct for an empty cluster.
+            m_CurrentCentroids.finalize();
 
             // echo for stuff
             DEBUG_PRINT("BEFORE CONVERGE\n" <<
@@ -165,6 +214,11 @@ namespace kmeans {
                 break;
             }
 
+            // if the ranks are drifting apart, move some points from the slow ones to the fast ones for the next iteration
+            balanceLoad(localAssignmentTime);
+
+            checkpointIfDue(iteration + 1);
+
             // now we're done with an iteration.
             if constexpr (DEBUG_FLAG) {
                 std::cout << "Rank " << m_Communicator.rank() << "Iteration " << iteration << std::endl;
@@ -181,8 +235,367 @@ namespace kmeans {
         }
 
         m_FinalIterationCount = iteration;
-        m_CalculatedCentroidsAtCompletion = m_CurrentCentroids;
+        m_CalculatedCentroidsAtCompletion = m_CurrentCentroids.toPoints();
+
+    }
+
+    void MPISolver::runMiniBatch() {
+        PROFILE_FUNCTION();
+
+        // like the serial version, the centroids are nudged rather than rebuilt. Every rank holds identical centroids
+        // (and running counts), samples a batch from its own points, and then the batch accumulators are all-reduced.
+        // That is k * (d + 1) doubles per iteration, regardless of the dataset or batch size, plus two more for the
+        // batch inertia and size, which ride along in the same reduction so there is still only one collective.
+        CentroidMatrix batchSums(m_CurrentCentroids.numCentroids(), m_CurrentCentroids.numDimensions());
+        const PointMatrix &localPoints = m_LocalDataSet.getPoints();
+        const size_t bufferSize = batchSums.bufferSize();
+        AlignedDoubleVector reduction(bufferSize + 2);
+
+        size_t iteration = m_StartIteration;
+        while (iteration < m_MaxIterations) {
+            PROFILE_SCOPE("Iteration");
+
+            m_PreviousCentroids = m_CurrentCentroids;
+            batchSums.zero();
+
+            const double localInertia = accumulateMiniBatch(localPoints, m_CurrentCentroids, m_MiniBatchSize, m_MiniBatchRng, batchSums);
+
+            std::copy_n(batchSums.buffer(), bufferSize, reduction.begin());
+            reduction[bufferSize] = localInertia;
+            reduction[bufferSize + 1] = localPoints.numPoints() == 0 ? 0.0 : static_cast<double>(m_MiniBatchSize);
+            {
+                PROFILE_SCOPE("Reducing mini-batch");
+                m_CentroidReducer->reduce(reduction.data(), reduction.size());
+            }
+            std::copy_n(reduction.begin(), bufferSize, batchSums.buffer());
+
+            // every rank applies the same global batch to the same centroids, so they stay in lockstep without a broadcast
+            m_CurrentCentroids.applyMiniBatch(batchSums);
+
+            // the reduced inertia is identical on every rank, so every rank stops on the same iteration
+            const bool stalled = m_MiniBatchConvergence.update(reduction[bufferSize], reduction[bufferSize + 1]);
+            if (stalled || areCentroidsConverged(m_PreviousCentroids, m_CurrentCentroids, m_ConvergenceThreshold)) {
+                break;
+            }
+
+            checkpointIfDue(iteration + 1);
+
+            ++iteration;
+        }
+
+        m_FinalIterationCount = iteration;
+        m_CalculatedCentroidsAtCompletion = m_CurrentCentroids.toPoints();
+    }
+
+    void MPISolver::runSharded() {
+        PROFILE_FUNCTION();
+
+        const auto numRanks = static_cast<size_t>(m_Communicator.size());
+        const int rank = m_Communicator.rank();
+        const int next = (rank + 1) % static_cast<int>(numRanks);
+        const int previous = (rank + static_cast<int>(numRanks) - 1) % static_cast<int>(numRanks);
+        const size_t numDimensions = m_CurrentCentroids.numDimensions();
+
+        // a travelling block is one flat run of doubles: [rows][rows * d points][rows best squared distances][rows best
+        // centroids]. The centroid indices are exact as doubles up to 2^53, and that way the whole block is one message.
+        const auto blockCapacity = [numDimensions](const size_t rows) { return 1 + rows * (numDimensions + 2); };
+        AlignedDoubleVector block;
+        AlignedDoubleVector incoming;
+        size_t rebalancesSeen = m_RebalanceCount;
+        const auto sizeBlocks = [&] {
+            unsigned long long maxRows = m_LocalDataSet.size();
+            MPI_Allreduce(MPI_IN_PLACE, &maxRows, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, m_Communicator);
+            block.assign(blockCapacity(maxRows), 0.0);
+            incoming.assign(blockCapacity(maxRows), 0.0);
+        };
+        sizeBlocks();
+
+        size_t iteration = m_StartIteration;
+        while (iteration < m_MaxIterations) {
+            PROFILE_SCOPE("Iteration");
+
+            // same double buffer as run(): class against the previous block of centroids, accumulate into the current
+            std::swap(m_PreviousCentroids, m_CurrentCentroids);
+            m_CurrentCentroids.zero();
+
+            // our own points set off with no best centroid yet
+            const PointMatrix &localPoints = m_LocalDataSet.getPoints();
+            const size_t localRows = localPoints.numPoints();
+            block[0] = static_cast<double>(localRows);
+            std::copy_n(localPoints.data(), localRows * numDimensions, block.begin() + 1);
+            std::fill_n(block.begin() + 1 + static_cast<std::ptrdiff_t>(localRows * numDimensions), localRows, std::numeric_limits<double>::max());
+            std::fill_n(block.begin() + 1 + static_cast<std::ptrdiff_t>(localRows * (numDimensions + 1)), localRows, -1.0);
+
+            // every block visits every rank once. Blocks go to next and come from previous, so after s passes we hold
+            // the block that started s ranks before us. After the last of the numRanks - 1 passes, that's the block that
+            // started at the rank after us (rank + 1, mod numRanks), with its final labels
+            double localAssignmentTime = 0.0;
+            for (size_t step = 0; step < numRanks; ++step) {
+                const double classifyStart = MPI_Wtime();
+                classifyBlockAgainstShard(block.data());
+                localAssignmentTime += MPI_Wtime() - classifyStart;
+
+                if (step + 1 < numRanks) {
+                    PROFILE_SCOPE("Passing block");
+                    const auto rows = static_cast<size_t>(block[0]);
+                    MPI_Sendrecv(block.data(), static_cast<int>(blockCapacity(rows)), MPI_DOUBLE, next, m_WorkingTag,
+                                 incoming.data(), static_cast<int>(incoming.size()), MPI_DOUBLE, previous, m_WorkingTag,
+                                 m_Communicator, MPI_STATUS_IGNORE);
+                    std::swap(block, incoming);
+                }
+            }
+
+            accumulateBlockOnOwners(block.data());
+            m_CurrentCentroids.finalize();
+
+            // every rank can only check its own block, so all of them have to agree
+            int converged = areCentroidsConverged(m_PreviousCentroids, m_CurrentCentroids, m_ConvergenceThreshold) ? 1 : 0;
+            MPI_Allreduce(MPI_IN_PLACE, &converged, 1, MPI_INT, MPI_LAND, m_Communicator);
+            if (converged != 0) {
+                break;
+            }
+
+            balanceLoad(localAssignmentTime);
+            if (m_RebalanceCount != rebalancesSeen) {
+                rebalancesSeen = m_RebalanceCount;
+                sizeBlocks();
+            }
+
+            checkpointIfDue(iteration + 1);
+
+            ++iteration;
+        }
+
+        m_FinalIterationCount = iteration;
+
+        // and only the main rank ever holds all k, at the very end, as the result
+        CentroidMatrix allCentroids = gatherCentroidShards();
+        if (rank == m_MainRank) {
+            m_CalculatedCentroidsAtCompletion = allCentroids.toPoints();
+        }
+    }
+
+    CentroidMatrix MPISolver::gatherCentroidShards() {
+        PROFILE_FUNCTION();
+
+        const auto numRanks = static_cast<size_t>(m_Communicator.size());
+        const size_t numDimensions = m_CurrentCentroids.numDimensions();
+        std::vector<int> sizes;
+        std::vector<int> displacements;
+        CentroidMatrix allCentroids;
+        if (m_Communicator.rank() == m_MainRank) {
+            allCentroids = CentroidMatrix(m_NumCentroids, numDimensions);
+            for (size_t part = 0; part < numRanks; ++part) {
+                const RowPartition shard = partitionRows(m_NumCentroids, numRanks, part);
+                sizes.push_back(static_cast<int>(shard.count));
+                displacements.push_back(static_cast<int>(shard.begin));
+            }
+        }
+
+        MPI_Datatype rowType;
+        MPI_Type_contiguous(static_cast<int>(numDimensions), MPI_DOUBLE, &rowType);
+        MPI_Type_commit(&rowType);
+        MPI_Gatherv(m_CurrentCentroids.coordinates(), static_cast<int>(m_CentroidShard.count), rowType,
+                    allCentroids.coordinates(), sizes.data(), displacements.data(), rowType, m_MainRank, m_Communicator);
+        MPI_Type_free(&rowType);
+
+        // the counts sit right after the coordinates, in the same centroid order
+        MPI_Gatherv(m_CurrentCentroids.buffer() + m_CentroidShard.count * numDimensions, static_cast<int>(m_CentroidShard.count), MPI_DOUBLE,
+                    allCentroids.buffer() + m_NumCentroids * numDimensions, sizes.data(), displacements.data(), MPI_DOUBLE, m_MainRank, m_Communicator);
+
+        return allCentroids;
+    }
+
+    void MPISolver::checkpointIfDue(const size_t completedIterations) {
+        // every rank knows the interval, so they all agree on when without talking
+        if (m_CheckpointInterval == 0 || completedIterations % m_CheckpointInterval != 0) {
+            return;
+        }
+        PROFILE_FUNCTION();
+
+        const bool isMainRank = m_Communicator.rank() == m_MainRank;
+        Checkpoint checkpoint{completedIterations, {}, {}, m_MiniBatchConvergence.getState()};
+
+        // only mini-batch still draws random numbers, and every rank has its own stream
+        if (m_MiniBatchSize > 0 && !m_ShardedCentroids) {
+            std::ostringstream state;
+            state << m_MiniBatchRng;
+            if (isMainRank) {
+                boost::mpi::gather(m_Communicator, state.str(), checkpoint.rngStates, m_MainRank);
+            } else {
+                boost::mpi::gather(m_Communicator, state.str(), m_MainRank);
+            }
+        }
 
+        // the centroids are the same on every rank, unless they are sharded
+        if (m_ShardedCentroids) {
+            checkpoint.centroids = gatherCentroidShards();
+        } else if (isMainRank) {
+            checkpoint.centroids = m_CurrentCentroids;
+        }
+
+        // the copy is all the iteration pays for. The writer thread does the rest
+        if (isMainRank) {
+            m_CheckpointWriter->submit(std::move(checkpoint));
+        }
+    }
+
+    void MPISolver::resumeFromCheckpoint(const std::filesystem::path &path, const size_t numCentroids, const size_t seed) {
+        PROFILE_FUNCTION();
+
+        unsigned long long nextIteration = 0;
+        int haveRngStates = 0;
+        std::vector<std::string> rngStates;
+        MiniBatchConvergence::State convergence;
+        std::string error;
+        if (m_Communicator.rank() == m_MainRank) {
+            try {
+                Checkpoint checkpoint = readCheckpoint(path);
+                if (checkpoint.centroids.numCentroids() != numCentroids || checkpoint.centroids.numDimensions() != m_LocalDataSet.numDimensions()) {
+                    throw std::invalid_argument("The checkpoint doesn't match the number of clusters or dimensions");
+                }
+                m_CurrentCentroids = std::move(checkpoint.centroids);
+                nextIteration = checkpoint.nextIteration;
+                rngStates = std::move(checkpoint.rngStates);
+                convergence = checkpoint.miniBatchConvergence;
+                haveRngStates = (rngStates.size() == static_cast<size_t>(m_Communicator.size())) ? 1 : 0;
+            } catch (const std::exception &exception) {
+                error = exception.what();
+            }
+        }
+
+        // only the main rank reads the file, so it has to tell the others if that went wrong, or they'd wait on the
+        // broadcasts below forever
+        boost::mpi::broadcast(m_Communicator, error, m_MainRank);
+        if (!error.empty()) {
+            throw std::runtime_error("Could not resume from " + path.string() + ": " + error);
+        }
+
+        // everything but the RNG streams is the same on every rank, so it all goes out in one broadcast
+        double header[6] = {static_cast<double>(nextIteration), static_cast<double>(haveRngStates), convergence.averageInertia,
+                            convergence.bestAverageInertia, static_cast<double>(convergence.batchesWithoutImprovement), convergence.started ? 1.0 : 0.0};
+        MPI_Bcast(header, 6, MPI_DOUBLE, m_MainRank, m_Communicator);
+        m_StartIteration = static_cast<size_t>(header[0]);
+        m_MiniBatchConvergence = MiniBatchConvergence({header[2], header[3], static_cast<size_t>(header[4]), header[5] != 0.0});
+
+        // the streams are per rank, so they only carry over one to one if the rank count did
+        if (header[1] != 0) {
+            std::string state;
+            if (m_Communicator.rank() == m_MainRank) {
+                boost::mpi::scatter(m_Communicator, rngStates, state, m_MainRank);
+            } else {
+                boost::mpi::scatter(m_Communicator, state, m_MainRank);
+            }
+            std::istringstream stateStream(state);
+            stateStream >> m_MiniBatchRng;
+
+            // a stream that doesn't parse is only noticed on the rank it went to, so agree on it before throwing
+            const int localFailed = stateStream.fail() ? 1 : 0;
+            int anyFailed = 0;
+            MPI_Allreduce(&localFailed, &anyFailed, 1, MPI_INT, MPI_MAX, m_Communicator);
+            if (anyFailed != 0) {
+                throw std::runtime_error("Could not resume from " + path.string() + ": the checkpoint's random number generator states are corrupt");
+            }
+        } else {
+            m_MiniBatchRng.seed(seed + 1 + static_cast<size_t>(m_Communicator.rank()) + m_StartIteration * static_cast<size_t>(m_Communicator.size()));
+        }
+    }
+
+    void MPISolver::classifyBlockAgainstShard(double* block) {
+        PROFILE_FUNCTION();
+
+        // with fewer centroids than ranks, some ranks have none, and can only pass the block on
+        const size_t numCentroids = m_PreviousCentroids.numCentroids();
+        if (numCentroids == 0) {
+            return;
+        }
+
+        const size_t numDimensions = m_PreviousCentroids.numDimensions();
+        const auto rows = static_cast<size_t>(block[0]);
+        const double* points = block + 1;
+        double* bestDistances = block + 1 + rows * numDimensions;
+        double* bestCentroids = bestDistances + rows;
+        const auto firstCentroid = static_cast<double>(m_CentroidShard.begin);
+
+        m_ThreadPool->run([&](const size_t threadIndex) {
+            const size_t end = m_ThreadPool->sliceBegin(threadIndex + 1, rows);
+            for (size_t row = m_ThreadPool->sliceBegin(threadIndex, rows); row < end; ++row) {
+                const kernel::NearestCentroid nearest = kernel::findNearestCentroid(points + row * numDimensions, m_PreviousCentroids.coordinates(), numCentroids, numDimensions);
+                const double centroid = firstCentroid + static_cast<double>(nearest.index);
+
+                // ties go to the lowest index, like everywhere else, whichever order the shards were visited in
+                if (nearest.squaredDistance < bestDistances[row] || (nearest.squaredDistance == bestDistances[row] && centroid < bestCentroids[row])) {
+                    bestDistances[row] = nearest.squaredDistance;
+                    bestCentroids[row] = centroid;
+                }
+            }
+        });
+    }
+
+    void MPISolver::accumulateBlockOnOwners(const double* block) {
+        PROFILE_FUNCTION();
+
+        const auto numRanks = static_cast<size_t>(m_Communicator.size());
+        const size_t numDimensions = m_CurrentCentroids.numDimensions();
+        const auto rows = static_cast<size_t>(block[0]);
+        const double* points = block + 1;
+        const double* bestCentroids = block + 1 + rows * (numDimensions + 1);
+
+        // sort the rows by centroid, so every centroid's rows are together, and the centroids are grouped by owner
+        std::vector<size_t> order(rows);
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, [bestCentroids](const size_t lhs, const size_t rhs) { return bestCentroids[lhs] < bestCentroids[rhs]; });
+
+        // then one record per centroid that has points here: [centroid][count][d sums]. That is never more than the
+        // points themselves, and usually far less
+        const size_t recordSize = numDimensions + 2;
+        std::vector<double> records;
+        std::vector<int> sendCounts(numRanks, 0);
+        for (size_t index = 0; index < rows;) {
+            const double centroid = bestCentroids[order[index]];
+            const size_t recordStart = records.size();
+            records.resize(recordStart + recordSize, 0.0);
+            records[recordStart] = centroid;
+            for (; index < rows && bestCentroids[order[index]] == centroid; ++index) {
+                const double* point = points + order[index] * numDimensions;
+                records[recordStart + 1] += 1.0;
+                for (size_t dimension = 0; dimension < numDimensions; ++dimension) {
+                    records[recordStart + 2 + dimension] += point[dimension];
+                }
+            }
+            ++sendCounts[partitionOfRow(m_NumCentroids, numRanks, static_cast<size_t>(centroid))];
+        }
+
+        std::vector<int> receiveCounts(numRanks);
+        MPI_Alltoall(sendCounts.data(), 1, MPI_INT, receiveCounts.data(), 1, MPI_INT, m_Communicator);
+
+        std::vector<int> sendDisplacements(numRanks, 0);
+        std::vector<int> receiveDisplacements(numRanks, 0);
+        std::exclusive_scan(sendCounts.begin(), sendCounts.end(), sendDisplacements.begin(), 0);
+        std::exclusive_scan(receiveCounts.begin(), receiveCounts.end(), receiveDisplacements.begin(), 0);
+        const size_t numReceived = static_cast<size_t>(receiveDisplacements.back() + receiveCounts.back());
+
+        MPI_Datatype recordType;
+        MPI_Type_contiguous(static_cast<int>(recordSize), MPI_DOUBLE, &recordType);
+        MPI_Type_commit(&recordType);
+        std::vector<double> received(numReceived * recordSize);
+        {
+            PROFILE_SCOPE("Sending sums to owners");
+            MPI_Alltoallv(records.data(), sendCounts.data(), sendDisplacements.data(), recordType,
+                          received.data(), receiveCounts.data(), receiveDisplacements.data(), recordType, m_Communicator);
+        }
+        MPI_Type_free(&recordType);
+
+        // and every record we got is for one of our own centroids
+        for (size_t record = 0; record < numReceived; ++record) {
+            const double* values = received.data() + record * recordSize;
+            const size_t centroid = static_cast<size_t>(values[0]) - m_CentroidShard.begin;
+            double* sum = m_CurrentCentroids.row(centroid);
+            for (size_t dimension = 0; dimension < numDimensions; ++dimension) {
+                sum[dimension] += values[2 + dimension];
+            }
+            m_CurrentCentroids.setCount(centroid, m_CurrentCentroids.getCount(centroid) + values[1]);
+        }
     }
 
     void MPISolver::initialDistributeDataSet(DataSet &&dataSet) {
@@ -190,183 +603,482 @@ namespace kmeans {
         // clear our local dataset so we can later insert
         m_LocalDataSet = DataSet();
 
+        // every rank needs to know how many points there are and how wide they are. From that alone, each rank can
+        // work out its own partition, so there is no need to scatter the sizes.
+        unsigned long long shape[2] = {0, 0};
+        if (m_Communicator.rank() == m_MainRank) {
+            shape[0] = dataSet.size();
+            shape[1] = dataSet.numDimensions();
+        }
+        {
+            PROFILE_SCOPE("Broadcasting shape");
+            MPI_Bcast(shape, 2, MPI_UNSIGNED_LONG_LONG, m_MainRank, m_Communicator);
+        }
+        const size_t numPoints = shape[0];
+        const size_t numDimensions = shape[1];
+        const size_t numPartitions = static_cast<size_t>(m_Communicator.size());
+
+        // one point is one element of this type, so the counts and displacements below are in points, not doubles.
+        // That also keeps the int counts MPI wants from overflowing d times sooner than they have to.
+        MPI_Datatype rowType;
+        MPI_Type_contiguous(static_cast<int>(numDimensions), MPI_DOUBLE, &rowType);
+        MPI_Type_commit(&rowType);
+
+        // the receive buffer IS our final storage. MPI writes the points straight into the local matrix.
+        const RowPartition myPartition = partitionRows(numPoints, numPartitions, static_cast<size_t>(m_Communicator.rank()));
+        PointMatrix localPoints(myPartition.count, numDimensions);
+
+        DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Receiving " << myPartition.count << " points from " << myPartition.begin);
+
         if (m_Communicator.rank() == m_MainRank) {
             PROFILE_SCOPE("Main Rank");
 
-            // we are main rank and thus hold the dataset
-            // calculate partition keys
-            int dataSetSize = static_cast<int>(dataSet.size());
-            int numPartitions = m_Communicator.size();
-            int dataSetPartitionAmount = dataSetSize / numPartitions;
-            int dataSetRemainder = dataSetSize % numPartitions;
-
-            int currentCentroidsSize = static_cast<int>(m_CurrentCentroids.size());
-
-            // I may not need these so commented for now, but may use them
-            // int currentCentroidsPartitionKey = currentCentroidsSize / numPartitions;
-            // int currentCentroidsRemainder = currentCentroidsSize % numPartitions;
-
-            // we need to calculate the displacements and sizes
-            std::vector<int> displacements;
-            std::vector<int> sizes;
-            displacements.reserve(numPartitions);
-            sizes.reserve(numPartitions);
-
-            DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Num Partitions: " << numPartitions);
-            DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Data Set Partition Amount: " << dataSetPartitionAmount);
-            DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Data Set Remainder: " << dataSetRemainder);
-            DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Current Centroids Size: " << currentCentroidsSize);
-            std::ranges::for_each(std::ranges::views::iota(0, numPartitions), [&](int currentPartition) {
-                const unsigned char remainderAmount = (currentPartition < dataSetRemainder) ? 1 : 0;
-                if (currentPartition > 0) {
-                    // there is a previous partition
-                    displacements.emplace_back(displacements.back() + sizes.back());
-                    // the current displacement is the previous displacement plus the
-                } else {
-                    displacements.emplace_back(0); // the first displacement is 0
-                }
-                sizes.emplace_back(dataSetPartitionAmount + remainderAmount); // sizes are easy.
+            // we are main rank and thus hold the dataset, so we need everybody's counts and displacements
+            std::vector<int> sizes(numPartitions);
+            std::vector<int> displacements(numPartitions);
+            for (size_t partition = 0; partition < numPartitions; ++partition) {
+                const RowPartition rows = partitionRows(numPoints, numPartitions, partition);
+                sizes[partition] = static_cast<int>(rows.count);
+                displacements[partition] = static_cast<int>(rows.begin);
                 // [a,b,c,d,e,f,g,h,i,j]
                 // [0,4,7]
                 // [4,3,3]
-            });
-
-            // create our local buffers
-            std::vector<Point> rawLocalDataSet;
-            int rawLocalDataSetSize = 0;
+            }
 
-            // we can scatter the sizes
             {
-                PROFILE_SCOPE("Scattering sizes");
-
-                DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Scattering sizes" << std::endl
-                    << "\trawLocalDataSet " << rawLocalDataSet.size() << std::endl
-                    << "\trawLocalDataSetSize " << rawLocalDataSetSize << std::endl
-                    << "\tdisplacements " << displacements.size() << std::endl
-                    << "\tsizes " << sizes.size() << std::endl
+                PROFILE_SCOPE("Scattering dataset");
+                MPI_Scatterv(
+                    dataSet.getPoints().data(), sizes.data(), displacements.data(), rowType,
+                    localPoints.data(), static_cast<int>(myPartition.count), rowType,
+                    m_MainRank, m_Communicator
                 );
-                boost::mpi::scatter(m_Communicator, sizes, rawLocalDataSetSize, m_MainRank);
             }
+        } else {
+            PROFILE_SCOPE("Worker Rank");
 
-            // now, allocate space in rawLocalDataSet
-            rawLocalDataSet.resize(rawLocalDataSetSize);
-
-            DEBUG_PRINT("Rank " << m_Communicator.rank() << " rawLocalDataSet size " << rawLocalDataSet.size());
+            if (dataSet.size() != 0) {
+                DEBUG_PRINT("Dataset size: " << dataSet.size() << " is illogical. Only main rank should have data");
+            }
 
-            // now that we've sanity checked, it's time to scatter the points
             {
                 PROFILE_SCOPE("Scattering dataset");
-                boost::mpi::scatterv(
-                    m_Communicator,
-                    dataSet.getPoints(),
-                    sizes,
-                    displacements,
-                    rawLocalDataSet.data(),
-                    rawLocalDataSetSize,
-                    m_MainRank
+                MPI_Scatterv(
+                    nullptr, nullptr, nullptr, rowType,
+                    localPoints.data(), static_cast<int>(myPartition.count), rowType,
+                    m_MainRank, m_Communicator
                 );
             }
+        }
 
-            // now that we've scattered, we can move the data into our local dataset
-            m_LocalDataSet = DataSet(std::move(rawLocalDataSet));
+        MPI_Type_free(&rowType);
+
+        // and the matrix moves into the dataset, no copy
+        m_LocalDataSet = DataSet(std::move(localPoints));
+    }
+
+    void MPISolver::initialDistributeCentroids(const size_t numCentroids) {
+        PROFILE_FUNCTION();
 
-            // next, we need to scatter our initial centroids
+        // the worker ranks know k from the config and d from the dataset distribution, so they can size their matrix
+        // and receive the whole [coordinates][counts] block as one flat broadcast
+        if (m_Communicator.rank() != m_MainRank) {
+            m_CurrentCentroids = CentroidMatrix(numCentroids, m_LocalDataSet.numDimensions());
+        }
 
+        if (m_NodeTopology) {
+            // the centroids only cross the network once per node, into a staging window in the leader's memory, and each
+            // rank copies them out into its own matrix. That saves network traffic, not memory, since every rank still
+            // keeps its own copies. The main rank is always rank 0 of the leaders.
+            m_NodeCentroids = std::make_unique<SharedWindow>(m_NodeTopology->nodeCommunicator(), m_NodeTopology->isLeader() ? m_CurrentCentroids.bufferSize() * sizeof(double) : 0);
+            auto* shared = reinterpret_cast<double*>(m_NodeCentroids->of(0));
+            if (m_NodeTopology->isLeader()) {
+                if (m_Communicator.rank() == m_MainRank) {
+                    std::copy_n(m_CurrentCentroids.buffer(), m_CurrentCentroids.bufferSize(), shared);
+                }
+                MPI_Bcast(shared, static_cast<int>(m_CurrentCentroids.bufferSize()), MPI_DOUBLE, 0, m_NodeTopology->leaderCommunicator());
+            }
+            m_NodeCentroids->synchronize();
+            std::copy_n(shared, m_CurrentCentroids.bufferSize(), m_CurrentCentroids.buffer());
         } else {
-            PROFILE_SCOPE("Worker Rank");
+            boost::mpi::broadcast(m_Communicator, m_CurrentCentroids.buffer(), static_cast<int>(m_CurrentCentroids.bufferSize()), m_MainRank);
+        }
 
-            if (dataSet.size() != 0) {
-                DEBUG_PRINT("Dataset size: " << dataSet.size() << " is illogical. Only main rank should have data");
+        if constexpr (DEBUG_FLAG) {
+            if (m_Communicator.rank() == m_MainRank) {
+                std::cout << "Main Rank Initial Centroids after broadcast (Rank " << m_Communicator.rank() << "): " << m_CurrentCentroids.size() << std::endl;
+            } else {
+                std::cout << "Worker Rank " << m_Communicator.rank() << " Initial Centroids after broadcast (Rank " << m_Communicator.rank() << "): " << m_CurrentCentroids.size() << std::endl;
             }
-            // create our local buffers
-            std::vector<Point> rawLocalDataSet;
-            int rawLocalDataSetSize = 0;
+        }
 
-            // we can scatter the sizes
-            {
-                PROFILE_SCOPE("Scattering sizes");
-                DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Scattering sizes" << std::endl
-                    << "\trawLocalDataSet " << rawLocalDataSet.size() << std::endl
-                    << "\trawLocalDataSetSize " << rawLocalDataSetSize << std::endl
-                    //<< "\tdisplacements " << displacements.size() << std::endl
-                    //<< "\tsizes " << sizes.size() << std::endl
-                );
-                // scatter the sizes
-                boost::mpi::scatter(m_Communicator, std::vector<int>(), rawLocalDataSetSize, m_MainRank);
+    }
+
+    void MPISolver::initialDistributeCentroidShards(const size_t numCentroids) {
+        PROFILE_FUNCTION();
+
+        const auto numRanks = static_cast<size_t>(m_Communicator.size());
+        const size_t numDimensions = m_LocalDataSet.numDimensions();
+        m_NumCentroids = numCentroids;
+        m_CentroidShard = partitionRows(numCentroids, numRanks, static_cast<size_t>(m_Communicator.rank()));
+
+        // like the dataset, the shards are scattered as rows, straight into their final storage
+        std::vector<int> sizes;
+        std::vector<int> displacements;
+        if (m_Communicator.rank() == m_MainRank) {
+            for (size_t part = 0; part < numRanks; ++part) {
+                const RowPartition shard = partitionRows(numCentroids, numRanks, part);
+                sizes.push_back(static_cast<int>(shard.count));
+                displacements.push_back(static_cast<int>(shard.begin));
             }
+        }
+
+        MPI_Datatype rowType;
+        MPI_Type_contiguous(static_cast<int>(numDimensions), MPI_DOUBLE, &rowType);
+        MPI_Type_commit(&rowType);
+        CentroidMatrix shard(m_CentroidShard.count, numDimensions);
+        MPI_Scatterv(m_CurrentCentroids.coordinates(), sizes.data(), displacements.data(), rowType,
+                     shard.coordinates(), static_cast<int>(m_CentroidShard.count), rowType, m_MainRank, m_Communicator);
+        MPI_Type_free(&rowType);
 
-            // now, allocate space in rawLocalDataSet
-            rawLocalDataSet.resize(rawLocalDataSetSize);
-            DEBUG_PRINT("Rank " << m_Communicator.rank() << " rawLocalDataSet size " << rawLocalDataSet.size());
+        m_CurrentCentroids = std::move(shard);
+    }
+
+    void MPISolver::moveDataSetToNodeWindow() {
+        PROFILE_FUNCTION();
+
+        const PointMatrix &points = m_LocalDataSet.getPoints();
+        const size_t numPoints = points.numPoints();
+        const size_t numDimensions = points.numDimensions();
+        const size_t numValues = numPoints * numDimensions;
 
+        // each piece is rounded up to a cache line, so no two ranks ever share one
+        const size_t bytes = (numValues * sizeof(double) + 63) / 64 * 64;
+        auto window = std::make_shared<SharedWindow>(m_NodeTopology->nodeCommunicator(), bytes);
+        auto* rows = reinterpret_cast<double*>(window->local());
+        std::copy_n(points.data(), numValues, rows);
 
-            // now that we've sanity checked, it's time to scatter the dataset
+        window->synchronize();
+
+        // the view keeps the window alive for as long as the dataset is, and the old dataset (and its storage) goes away
+        m_LocalDataSet = DataSet(PointMatrix::view(rows, numPoints, numDimensions, std::move(window)));
+    }
+
+    void MPISolver::assignAndReducePipelined() {
+        PROFILE_FUNCTION();
+
+        const PointMatrix &localPoints = m_LocalDataSet.getPoints();
+        const size_t numLocalPoints = localPoints.numPoints();
+        m_AssignmentEngine->prepare(localPoints, m_PreviousCentroids);
+
+        // every rank has to start the same number of reductions, in the same order, even with no points in a chunk
+        m_ChunkSums.resize(m_PipelineChunks);
+        for (CentroidMatrix &chunkSum : m_ChunkSums) {
+            if (chunkSum.numCentroids() != m_CurrentCentroids.numCentroids() || chunkSum.numDimensions() != m_CurrentCentroids.numDimensions()) {
+                chunkSum = CentroidMatrix(m_CurrentCentroids.numCentroids(), m_CurrentCentroids.numDimensions());
+            } else {
+                chunkSum.zero();
+            }
+        }
+
+        std::vector<MPI_Request> requests(m_PipelineChunks, MPI_REQUEST_NULL);
+        std::vector<double> startTimes(m_PipelineChunks, 0.0);
+        std::vector<double> completionTimes(m_PipelineChunks, 0.0);
+        std::vector<int> completed(m_PipelineChunks);
+
+        // notes the time of any reduction that has finished since we last looked. Testing also lets MPI make progress,
+        // since many implementations only move a non-blocking collective along from inside an MPI call
+        const auto pollCompletions = [&](const size_t numStarted) {
+            int numCompleted = 0;
+            MPI_Testsome(static_cast<int>(numStarted), requests.data(), &numCompleted, completed.data(), MPI_STATUSES_IGNORE);
+            const double now = MPI_Wtime();
+            for (int index = 0; index < numCompleted && numCompleted != MPI_UNDEFINED; ++index) {
+                completionTimes[completed[index]] = now;
+            }
+        };
+
+        for (size_t chunk = 0; chunk < m_PipelineChunks; ++chunk) {
+            const size_t begin = numLocalPoints * chunk / m_PipelineChunks;
+            const size_t end = numLocalPoints * (chunk + 1) / m_PipelineChunks;
             {
-                PROFILE_SCOPE("Scattering dataset");
-                boost::mpi::scatterv(
-                    m_Communicator,
-                    std::vector<Point>(),
-                    std::vector<int>(),
-                    std::vector<int>(),
-                    rawLocalDataSet.data(),
-                    rawLocalDataSetSize,
-                    m_MainRank
-                );
+                PROFILE_SCOPE("Classing chunk");
+                assignRangeAcrossThreads(*m_AssignmentEngine, *m_ThreadPool, localPoints, m_PreviousCentroids, begin, end, m_ThreadSums, m_ChunkSums[chunk]);
             }
 
-            // now that we've scattered, we can move the data into our local dataset
-            m_LocalDataSet = DataSet(std::move(rawLocalDataSet));
+            MPI_Iallreduce(MPI_IN_PLACE, m_ChunkSums[chunk].buffer(), static_cast<int>(m_ChunkSums[chunk].bufferSize()), MPI_DOUBLE, MPI_SUM, m_Communicator, &requests[chunk]);
+            startTimes[chunk] = MPI_Wtime();
+            pollCompletions(chunk + 1);
+        }
+
+        // whatever is still in flight now is the exposed part
+        const double waitStart = MPI_Wtime();
+        {
+            PROFILE_SCOPE("Waiting on reductions");
+            MPI_Waitall(static_cast<int>(m_PipelineChunks), requests.data(), MPI_STATUSES_IGNORE);
+        }
+        const double waitEnd = MPI_Wtime();
+
+        m_ExposedCommunicationTime += waitEnd - waitStart;
+        for (size_t chunk = 0; chunk < m_PipelineChunks; ++chunk) {
+            // a reduction that finished before the wait was entirely hidden, one that didn't was hidden up until the wait
+            const double hiddenUntil = (completionTimes[chunk] > 0.0) ? completionTimes[chunk] : waitStart;
+            m_HiddenCommunicationTime += hiddenUntil - startTimes[chunk];
+        }
+
+        // the chunks are all global sums now, so adding them up gives the same global sum the phased path would
+        for (const CentroidMatrix &chunkSum : m_ChunkSums) {
+            m_CurrentCentroids += chunkSum;
         }
     }
 
-    void MPISolver::initialDistributeCentroids() {
+    void MPISolver::initializeCentroidsFromShards(const size_t numCentroids, const size_t seed) {
         PROFILE_FUNCTION();
 
-        boost::mpi::broadcast(m_Communicator, m_CurrentCentroids, m_MainRank);
+        const PointMatrix &localPoints = m_LocalDataSet.getPoints();
+        const size_t numDimensions = localPoints.numDimensions();
 
-        if constexpr (DEBUG_FLAG) {
-            if (m_Communicator.rank() == m_MainRank) {
-                std::cout << "Main Rank Initial Centroids after broadcast (Rank " << m_Communicator.rank() << "): " << m_CurrentCentroids.size() << std::endl;
-            } else {
-                std::cout << "Worker Rank " << m_Communicator.rank() << " Initial Centroids after broadcast (Rank " << m_Communicator.rank() << "): " << m_CurrentCentroids.size() << std::endl;
+        // work out which global rows are ours. The shards are in rank order, so ours start after every lower rank's
+        std::vector<size_t> localCounts;
+        boost::mpi::all_gather(m_Communicator, localPoints.numPoints(), localCounts);
+        const size_t numPoints = std::ranges::fold_left(localCounts, static_cast<size_t>(0), std::plus<>());
+        const size_t firstLocalPoint = std::accumulate(localCounts.begin(), localCounts.begin() + m_Communicator.rank(), static_cast<size_t>(0));
+        if (numCentroids > numPoints) {
+            throw std::invalid_argument("Cannot select more centroids than data points");
+        }
+
+        // every rank draws the same global indices, in the same way the main rank would with the whole dataset...
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> dist(0, numPoints - 1);
+        std::unordered_set<size_t> indices;
+        while (indices.size() < numCentroids) {
+            indices.emplace(dist(rng));
+        }
+
+        // ...and fills in only the rows it owns. Every centroid is owned by exactly one rank, and everyone else leaves
+        // it at zero, so a sum to the main rank assembles the whole matrix
+        m_CurrentCentroids = CentroidMatrix(numCentroids, numDimensions);
+        size_t centroid = 0;
+        for (const size_t index : indices) {
+            if (index >= firstLocalPoint && index - firstLocalPoint < localPoints.numPoints()) {
+                std::copy_n(localPoints.row(index - firstLocalPoint), numDimensions, m_CurrentCentroids.row(centroid));
+                m_CurrentCentroids.setCount(centroid, 1.0);
             }
+            ++centroid;
         }
 
+        const bool isMainRank = m_Communicator.rank() == m_MainRank;
+        MPI_Reduce(isMainRank ? MPI_IN_PLACE : m_CurrentCentroids.buffer(), m_CurrentCentroids.buffer(),
+                   static_cast<int>(m_CurrentCentroids.bufferSize()), MPI_DOUBLE, MPI_SUM, m_MainRank, m_Communicator);
     }
 
-    void MPISolver::globalReduceCentroids() {
+    void MPISolver::initializeCentroidsScalable(const size_t numCentroids, const size_t seed) {
         PROFILE_FUNCTION();
 
-        // since we are doing a reduction we need to flatten it into MPI primitives
-        std::vector<Point> newCentroids;
-        newCentroids.reserve(m_CurrentCentroids.size());
-        boost::mpi::all_reduce(m_Communicator, m_CurrentCentroids, newCentroids, AddPointsFuctor());
-        m_CurrentCentroids = std::move(newCentroids);
+        const PointMatrix &localPoints = m_LocalDataSet.getPoints();
+        const size_t numLocalPoints = localPoints.numPoints();
+        const size_t numDimensions = localPoints.numDimensions();
+        MPI_Comm communicator = m_Communicator;
+
+        // the shared generator makes the same choices on every rank, the local one makes different choices on each
+        std::mt19937 sharedRng(seed);
+        std::mt19937 localRng(seed + 1 + static_cast<size_t>(m_Communicator.rank()));
+
+        // every rank learns how the points are split, so the first candidate can be uniform over the whole dataset
+        std::vector<size_t> localCounts;
+        boost::mpi::all_gather(m_Communicator, numLocalPoints, localCounts);
+        const size_t numPoints = std::ranges::fold_left(localCounts, static_cast<size_t>(0), std::plus<>());
+        if (numCentroids > numPoints) {
+            throw std::invalid_argument("Cannot select more centroids than data points");
+        }
+
+        size_t first = std::uniform_int_distribution<size_t>(0, numPoints - 1)(sharedRng);
+        int owner = 0;
+        while (first >= localCounts[owner]) {
+            first -= localCounts[owner];
+            ++owner;
+        }
+
+        AlignedDoubleVector candidates(numDimensions);
+        if (m_Communicator.rank() == owner) {
+            std::copy_n(localPoints.row(first), numDimensions, candidates.begin());
+        }
+        boost::mpi::broadcast(m_Communicator, candidates.data(), static_cast<int>(numDimensions), owner);
+
+        // the squared distance from each local point to its closest candidate, kept up to date as candidates arrive,
+        // and the global sum of them (the potential)
+        std::vector<double> closest(numLocalPoints, std::numeric_limits<double>::max());
+        const auto updateClosest = [&](const size_t firstNewCandidate) {
+            const size_t numNewCandidates = candidates.size() / numDimensions - firstNewCandidate;
+            const double* newCandidates = candidates.data() + firstNewCandidate * numDimensions;
+            double localPotential = 0.0;
+            for (size_t index = 0; index < numLocalPoints; ++index) {
+                const auto nearest = kernel::findNearestCentroid(localPoints.row(index), newCandidates, numNewCandidates, numDimensions);
+                closest[index] = std::min(closest[index], nearest.squaredDistance);
+                localPotential += closest[index];
+            }
 
+            double potential = 0.0;
+            boost::mpi::all_reduce(m_Communicator, localPotential, potential, std::plus<double>());
+            return potential;
+        };
+
+        double potential = updateClosest(0);
+        const double oversampling = static_cast<double>(KMEANS_PARALLEL_OVERSAMPLING * numCentroids);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        // the usual number of rounds, plus however many more it takes to have at least k candidates. Every rank sees the
+        // same candidates and potential, so they all agree on when to stop
+        const auto haveEnoughCandidates = [&](const size_t round) {
+            return round >= KMEANS_PARALLEL_ROUNDS && candidates.size() / numDimensions >= numCentroids;
+        };
+        for (size_t round = 0; !haveEnoughCandidates(round) && potential > 0.0; ++round) {
+            PROFILE_SCOPE("k-means|| round");
+
+            // each point is picked independently, with probability proportional to its share of the potential
+            AlignedDoubleVector picked;
+            for (size_t index = 0; index < numLocalPoints; ++index) {
+                if (unit(localRng) < oversampling * closest[index] / potential) {
+                    picked.insert(picked.end(), localPoints.row(index), localPoints.row(index) + numDimensions);
+                }
+            }
+
+            // and then every rank gets every rank's picks, appended in rank order
+            std::vector<int> pickedSizes;
+            boost::mpi::all_gather(m_Communicator, static_cast<int>(picked.size()), pickedSizes);
+            std::vector<int> displacements(pickedSizes.size(), 0);
+            std::exclusive_scan(pickedSizes.begin(), pickedSizes.end(), displacements.begin(), 0);
+
+            const size_t firstNewCandidate = candidates.size() / numDimensions;
+            candidates.resize(candidates.size() + static_cast<size_t>(displacements.back() + pickedSizes.back()));
+            MPI_Allgatherv(picked.data(), static_cast<int>(picked.size()), MPI_DOUBLE,
+                           candidates.data() + firstNewCandidate * numDimensions, pickedSizes.data(), displacements.data(), MPI_DOUBLE,
+                           communicator);
+
+            if (candidates.size() / numDimensions > firstNewCandidate) {
+                potential = updateClosest(firstNewCandidate);
+            }
+        }
+
+        // a potential of zero with too few candidates means every point sits on a candidate already, so there aren't k
+        // distinct points to pick from, and repeating candidates would just leave clusters empty
+        const size_t numCandidates = candidates.size() / numDimensions;
+        if (numCandidates < numCentroids) {
+            throw std::invalid_argument("Cannot select more centroids than distinct data points");
+        }
+
+        // weight every candidate by how many points it is closest to
+        DEBUG_PRINT("Rank " << m_Communicator.rank() << ". k-means|| picked " << numCandidates << " candidates");
+        std::vector<double> localWeights(numCandidates, 0.0);
+        for (size_t index = 0; index < numLocalPoints; ++index) {
+            localWeights[kernel::findNearestCentroid(localPoints.row(index), candidates.data(), numCandidates, numDimensions).index] += 1.0;
+        }
+        std::vector<double> weights(numCandidates, 0.0);
+        boost::mpi::all_reduce(m_Communicator, localWeights.data(), static_cast<int>(numCandidates), weights.data(), std::plus<double>());
+
+        // finally, the main rank boils the candidates down to k. There are only O(k * rounds) of them, so this is cheap.
+        if (m_Communicator.rank() == m_MainRank) {
+            const PointMatrix candidateMatrix(numDimensions, std::move(candidates));
+            m_CurrentCentroids = kMeansPlusPlus(candidateMatrix, weights, numCentroids, sharedRng);
+        }
     }
 
-    void MPISolver::globalGatherCentroids(const std::vector<Point> &localCentroids) {
+    void MPISolver::balanceLoad(const double localAssignmentTime) {
         PROFILE_FUNCTION();
 
-        int size = static_cast<int>(localCentroids.size());
-        std::vector<int> sizes;
-        boost::mpi::all_gather(m_Communicator, size, sizes);
+        // every rank's time and row count, in one tiny all-gather, so every rank makes the same decision on its own
+        const auto numRanks = static_cast<size_t>(m_Communicator.size());
+        const double mine[2] = {localAssignmentTime, static_cast<double>(m_LocalDataSet.size())};
+        std::vector<double> everyone(2 * numRanks);
+        MPI_Allgather(mine, 2, MPI_DOUBLE, everyone.data(), 2, MPI_DOUBLE, m_Communicator);
+
+        double slowest = 0.0;
+        double totalTime = 0.0;
+        for (size_t rank = 0; rank < numRanks; ++rank) {
+            slowest = std::max(slowest, everyone[2 * rank]);
+            totalTime += everyone[2 * rank];
+        }
+        const double meanTime = totalTime / static_cast<double>(numRanks);
+        const double imbalance = (meanTime > 0.0) ? slowest / meanTime : 1.0;
+        m_ImbalanceSum += imbalance;
+        ++m_ImbalanceSamples;
+        ++m_IterationsSinceRebalance;
+
+        if (m_RebalanceThreshold <= 0.0 || imbalance <= 1.0 + m_RebalanceThreshold || m_IterationsSinceRebalance < REBALANCE_COOLDOWN) {
+            return;
+        }
 
-        // gather all local centroids.
-        boost::mpi::all_gatherv(m_Communicator, localCentroids, m_CurrentCentroids, sizes);
+        // how fast each rank is, in rows per second. A rank with no rows (or no measurable time) tells us nothing, so it
+        // is assumed to be as fast as the whole job on average
+        const double totalRows = std::accumulate(everyone.begin(), everyone.end(), 0.0) - totalTime;
+        const double meanSpeed = (totalTime > 0.0) ? totalRows / totalTime : 1.0;
+        std::vector<double> speeds(numRanks);
+        std::vector<RowPartition> from(numRanks);
+        size_t begin = 0;
+        for (size_t rank = 0; rank < numRanks; ++rank) {
+            const double time = everyone[2 * rank];
+            const auto rows = static_cast<size_t>(everyone[2 * rank + 1]);
+            speeds[rank] = (rows > 0 && time > 0.0) ? static_cast<double>(rows) / time : meanSpeed;
+            from[rank] = {begin, rows};
+            begin += rows;
+        }
 
+        DEBUG_PRINT("Rank " << m_Communicator.rank() << ". Imbalance " << imbalance << ", repartitioning");
+        migrateRows(from, partitionRowsProportionally(begin, speeds));
+        m_IterationsSinceRebalance = 0;
+        ++m_RebalanceCount;
     }
 
+    void MPISolver::migrateRows(const std::vector<RowPartition> &from, const std::vector<RowPartition> &to) {
+        PROFILE_FUNCTION();
+
+        const auto numRanks = static_cast<size_t>(m_Communicator.size());
+        const auto me = static_cast<size_t>(m_Communicator.rank());
+        const size_t numDimensions = m_CurrentCentroids.numDimensions();
+
+        // both partitions are contiguous and in rank order, so what moves between two ranks is just where their old and
+        // new ranges overlap, and what arrives lands in source rank order, which is exactly the new local order
+        const auto overlap = [](const RowPartition &lhs, const RowPartition &rhs) {
+            const size_t begin = std::max(lhs.begin, rhs.begin);
+            const size_t end = std::min(lhs.begin + lhs.count, rhs.begin + rhs.count);
+            return RowPartition{begin, (end > begin) ? end - begin : 0};
+        };
+        std::vector<int> sendCounts(numRanks), sendDisplacements(numRanks), receiveCounts(numRanks), receiveDisplacements(numRanks);
+        for (size_t rank = 0; rank < numRanks; ++rank) {
+            const RowPartition sent = overlap(from[me], to[rank]);
+            sendCounts[rank] = static_cast<int>(sent.count);
+            sendDisplacements[rank] = static_cast<int>(sent.count > 0 ? sent.begin - from[me].begin : 0);
+            const RowPartition received = overlap(from[rank], to[me]);
+            receiveCounts[rank] = static_cast<int>(received.count);
+            receiveDisplacements[rank] = static_cast<int>(received.count > 0 ? received.begin - to[me].begin : 0);
+        }
+
+        // as with the scatter, one point is one element
+        MPI_Datatype rowType;
+        MPI_Type_contiguous(static_cast<int>(numDimensions), MPI_DOUBLE, &rowType);
+        MPI_Type_commit(&rowType);
+
+        PointMatrix points(to[me].count, numDimensions);
+        {
+            PROFILE_SCOPE("Migrating points");
+            MPI_Alltoallv(m_LocalDataSet.getPoints().data(), sendCounts.data(), sendDisplacements.data(), rowType,
+                          points.data(), receiveCounts.data(), receiveDisplacements.data(), rowType, m_Communicator);
+        }
+        MPI_Type_free(&rowType);
 
-    void MPISolver::applyScalarToCentroids(std::vector<Point> &centroids) {
+        m_LocalDataSet = DataSet(std::move(points));
+        if (m_NodeSharedMemory) {
+            moveDataSetToNodeWindow();
+        }
+
+        // every engine's per-point state (bounds, labels, norms) was for the old rows, so start over with a fresh one
+        m_AssignmentEngine = AssignmentEngine::create(m_AssignmentBackend, m_YinyangGroupCount);
+    }
+
+    void MPISolver::globalReduceCentroids() {
         PROFILE_FUNCTION();
 
-        std::ranges::for_each(centroids, [](Point &centroid) {
-            if (centroid.getCount() > 0) {
-                centroid /= static_cast<double>(centroid.getCount());
-            }
-            // If getCount() is 0, the centroid sum is already {0,0,...}, which is correct for an empty cluster.
-        });
+        // the sums and the counts already sit in one contiguous block of doubles, so the reducer sums it in place.
+        // Flat or hierarchical, the solver doesn't need to know.
+        m_CentroidReducer->reduce(m_CurrentCentroids.buffer(), m_CurrentCentroids.bufferSize());
 
     }
 
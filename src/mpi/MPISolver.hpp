@@ -6,9 +6,21 @@
 #define KMEANS_MPI_MPISOLVER_HPP
 
 #include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <random>
 #include <boost/mpi/communicator.hpp>
 
+#include "../shared/AssignmentEngine.hpp"
+#include "../shared/Checkpoint.hpp"
 #include "../shared/DataSet.hpp"
+#include "../shared/Initialization.hpp"
+#include "../shared/MiniBatch.hpp"
+#include "../shared/Partition.hpp"
+#include "../shared/PointMatrix.hpp"
+#include "../shared/ThreadPool.hpp"
+#include "CentroidReduction.hpp"
+#include "NodeTopology.hpp"
 
 namespace kmeans {
 
@@ -22,6 +34,39 @@ namespace kmeans {
             size_t startingCentroidCount;
             int mainRank;
             int workingTag;
+            AssignmentBackend assignmentBackend = AssignmentBackend::PerPoint;
+            size_t yinyangGroupCount = 0;
+            /// If non-zero, run mini-batch k-means, with every rank sampling this many of its own points per iteration
+            size_t miniBatchSize = 0;
+            InitializationMethod initializationMethod = InitializationMethod::Random;
+            /// Threads per process, including the calling one. Zero means one per hardware thread.
+            size_t numThreads = 1;
+            /// If more than one, class the local points in this many chunks, and start each chunk's all-reduce while
+            /// the next chunk is being classed. The chunks are reduced flat, so this rules out ReductionStrategy::Hierarchical.
+            size_t pipelineChunks = 0;
+            /// If true, dataSet is already just this rank's shard (in rank order), so it is kept as is instead of scattered
+            bool dataSetIsDistributed = false;
+            /// If true, every rank's points move into its own piece of a node-wide shared memory window. No rank reads
+            /// another's piece, so this saves no memory. It costs an extra copy and a few collectives at startup, and
+            /// lays the node's points out in one segment. The centroids are only staged through a node window, at
+            /// startup and after every hierarchical reduction, and every rank still keeps its own copies. Needs mainRank
+            /// to be 0.
+            bool nodeSharedMemory = false;
+            /// How the per-rank sums are combined every iteration
+            ReductionStrategy reductionStrategy = ReductionStrategy::Flat;
+            /// If non-zero, move points from slow ranks to fast ones whenever the slowest rank's assignment takes more
+            /// than this fraction longer than the mean. E.g. 0.1 tolerates 10%.
+            double rebalanceThreshold = 0.0;
+            /// If true, every rank only holds its own block of the centroids, and blocks of points travel around a ring
+            /// instead. For very large k. The assignment backend, mini-batch and pipelining settings are ignored.
+            bool shardedCentroids = false;
+            /// Where the main rank writes checkpoints to, and resumes from
+            std::filesystem::path checkpointPath;
+            /// If non-zero (and checkpointPath is set), write a checkpoint every this many iterations, in the background
+            size_t checkpointInterval = 0;
+            /// If true, start from the checkpoint at checkpointPath instead of picking starting centroids. It may have
+            /// been written by any number of ranks.
+            bool resume = false;
 
             Config() = delete;
             Config(size_t maxIterations, double convergenceThreshold, DataSet dataSet, size_t startingCentroidSeed, size_t startingCentroidCount, int mainRank, int workingTag) :
@@ -46,20 +91,174 @@ namespace kmeans {
         void run();
 
         void initialDistributeDataSet(DataSet && dataSet);
-        void initialDistributeCentroids();
+        void initialDistributeCentroids(size_t numCentroids);
+
+        /**
+         * @brief Scatters the starting centroids from the main rank, so that every rank only keeps its own block of them,
+         * as given by partitionRows() over the centroids.
+         * @param numCentroids The total number of centroids (k)
+         */
+        void initialDistributeCentroidShards(size_t numCentroids);
+
+        /**
+         * @brief Loads the checkpoint at path on the main rank, in place of picking starting centroids, and tells every
+         * rank which iteration to carry on from.
+         *
+         * The centroids are left in m_CurrentCentroids on the main rank only, ready to be distributed. The mini-batch
+         * streams are restored when the rank count matches the run that wrote the checkpoint, and otherwise every rank
+         * starts a fresh stream, seeded from where the run is.
+         * @param path The checkpoint to load
+         * @param numCentroids The k this run expects
+         * @param seed The starting centroid seed, for the fresh streams
+         */
+        void resumeFromCheckpoint(const std::filesystem::path& path, size_t numCentroids, size_t seed);
+
+        /**
+         * @brief Picks the starting centroids with k-means|| (Bahmani et al., 2012), on the already distributed dataset.
+         *
+         * Every rank oversamples candidates from its own points by D^2, with the potential all-reduced, for a few
+         * rounds. The candidates are then weighted by how many points are closest to them, and the main rank reduces
+         * them to k with weighted k-means++. The result is left in m_CurrentCentroids on the main rank only, ready for
+         * initialDistributeCentroids().
+         * @param numCentroids How many centroids to pick (k)
+         * @param seed The seed for every random choice. All ranks must pass the same one.
+         */
+        void initializeCentroidsScalable(size_t numCentroids, size_t seed);
+
+        /**
+         * @brief Picks k uniformly random points as the starting centroids when the dataset was never on one rank.
+         *
+         * It draws exactly the global indices the main rank would have drawn from the whole dataset, and the rank that
+         * owns each index contributes that row. The result is left in m_CurrentCentroids on the main rank only, ready
+         * for initialDistributeCentroids().
+         * @param numCentroids How many centroids to pick (k)
+         * @param seed The seed for the draw. All ranks must pass the same one.
+         */
+        void initializeCentroidsFromShards(size_t numCentroids, size_t seed);
+
+        /**
+         * @brief Moves this rank's points into its piece of a shared memory window for the whole node.
+         *
+         * The pieces of the node's ranks are back to back in one segment, and every rank's dataset becomes a view of
+         * its own piece. The private copy is released. No rank ever reads another rank's piece, so the node holds just
+         * as many points as before. The only differences are one extra copy and the window's collectives.
+         */
+        void moveDataSetToNodeWindow();
+
+        /**
+         * @brief Shares every rank's assignment time for this iteration, records the imbalance, and repartitions the
+         * points if it is past the threshold.
+         *
+         * The new partition gives every rank rows in proportion to its measured speed (rows per second), and keeps
+         * them contiguous and in rank order, so one MPI_Alltoallv moves every row that changes owner. It won't
+         * repartition again for REBALANCE_COOLDOWN iterations, so one noisy iteration can't make it thrash.
+         * @param localAssignmentTime This rank's time, in seconds, spent classing its points this iteration
+         */
+        void balanceLoad(double localAssignmentTime);
+
+        /**
+         * @brief Moves rows between the ranks so the old partition becomes the new one, and resets the assignment engine.
+         * @param from Every rank's current rows, in rank order
+         * @param to Every rank's rows afterward, in rank order
+         */
+        void migrateRows(const std::vector<RowPartition>& from, const std::vector<RowPartition>& to);
 
         void globalReduceCentroids();
-        void globalGatherCentroids(const std::vector<Point> &localCentroids);
-        static void applyScalarToCentroids(std::vector<Point> &centroids);
+
+        /**
+         * @brief The pipelined alternative to a full assignment followed by globalReduceCentroids().
+         *
+         * The local rows are classed in m_PipelineChunks chunks, each into its own accumulator, and each chunk's
+         * MPI_Iallreduce is started as soon as that chunk is done, so it runs while the next chunks are classed. Once
+         * every chunk is in, the reduced chunks are summed into m_CurrentCentroids.
+         *
+         * The chunks always go through a flat all-reduce on the whole communicator, never m_CentroidReducer, so this
+         * can't be used with ReductionStrategy::Hierarchical.
+         */
+        void assignAndReducePipelined();
 
 
         inline std::optional<size_t> getFinalIterationCount() const { return m_FinalIterationCount; }
         inline const std::optional<std::vector<Point>>& getCalculatedCentroidsAtCompletion() const { return m_CalculatedCentroidsAtCompletion; }
 
+        /**
+         * @brief Gets the time, in seconds, this rank spent blocked waiting on pipelined reductions to finish.
+         */
+        inline double getExposedCommunicationTime() const { return m_ExposedCommunicationTime; }
+
+        /**
+         * @brief Gets the time, in seconds, pipelined reductions were in flight while this rank was still classing points.
+         *
+         * Completion is only noticed between chunks, so this is an upper bound, accurate to about one chunk.
+         */
+        inline double getHiddenCommunicationTime() const { return m_HiddenCommunicationTime; }
+
+        /**
+         * @brief Gets the time, in seconds, this rank spent in blocking centroid reductions, whichever strategy did them.
+         */
+        inline double getReductionTime() const { return m_CentroidReducer->getReductionTime(); }
+
+        /**
+         * @brief Gets the mean, over every iteration, of the slowest rank's assignment time divided by the mean rank's.
+         * @return 1 for a perfectly balanced run, or NaN if nothing was measured (mini-batch)
+         */
+        inline double getLoadImbalance() const {
+            return (m_ImbalanceSamples == 0) ? std::numeric_limits<double>::quiet_NaN() : m_ImbalanceSum / static_cast<double>(m_ImbalanceSamples);
+        }
+
+        /**
+         * @brief Gets how many times the points were repartitioned.
+         */
+        inline size_t getRebalanceCount() const { return m_RebalanceCount; }
+
+        /// Iterations to wait after a repartition before another is allowed
+        static constexpr size_t REBALANCE_COOLDOWN = 5;
+
     private:
+        /**
+         * @brief The mini-batch counterpart of run(). Each rank samples its own batch, and only the small batch
+         * accumulator is all-reduced.
+         */
+        void runMiniBatch();
+
+        /**
+         * @brief The sharded centroid counterpart of run().
+         *
+         * m_CurrentCentroids only holds this rank's block of the centroids. Every iteration, each rank's points set off
+         * around the ring together with their best (squared distance, centroid) so far, and every rank they pass through
+         * improves that with the nearest centroid of its own block. Once a block has been everywhere, the rank holding it
+         * sums its points per centroid and sends those partial sums to the ranks that own the centroids.
+         */
+        void runSharded();
+
+        /**
+         * @brief Improves the best (squared distance, centroid) of every point in a travelling block with this rank's
+         * block of the previous centroids.
+         */
+        void classifyBlockAgainstShard(double* block);
+
+        /**
+         * @brief Sums the points of a block per centroid, and sends every sum to the rank that owns that centroid, which
+         * adds it into m_CurrentCentroids.
+         */
+        void accumulateBlockOnOwners(const double* block);
+
+        /**
+         * @brief Collects every rank's block of the sharded centroids. Collective.
+         * @return All k centroids on the main rank, and an empty matrix everywhere else
+         */
+        CentroidMatrix gatherCentroidShards();
+
+        /**
+         * @brief Writes a checkpoint from the main rank, in the background, if this is an iteration that should have one.
+         * Collective, since the RNG states (and sharded centroids) have to be gathered first.
+         * @param completedIterations How many iterations have been run so far, including the one just finished
+         */
+        void checkpointIfDue(size_t completedIterations);
+
         DataSet m_LocalDataSet;
-        std::vector<Point> m_CurrentCentroids;
-        std::vector<Point> m_PreviousCentroids;
+        CentroidMatrix m_CurrentCentroids;
+        CentroidMatrix m_PreviousCentroids;
         size_t m_MaxIterations;
         double m_ConvergenceThreshold;
         std::optional<std::vector<Point>> m_CalculatedCentroidsAtCompletion = std::nullopt;
@@ -67,6 +266,41 @@ namespace kmeans {
         int m_MainRank;
         int m_WorkingTag;
         std::optional<size_t> m_FinalIterationCount = std::nullopt;
+        std::unique_ptr<AssignmentEngine> m_AssignmentEngine;
+        std::unique_ptr<ThreadPool> m_ThreadPool;
+        std::vector<CentroidMatrix> m_ThreadSums;
+        size_t m_PipelineChunks = 0;
+        std::vector<CentroidMatrix> m_ChunkSums;
+        double m_ExposedCommunicationTime = 0.0;
+        double m_HiddenCommunicationTime = 0.0;
+        size_t m_MiniBatchSize = 0;
+        std::mt19937 m_MiniBatchRng;
+        /// Only when the node shared memory or the hierarchical reduction is on
+        std::unique_ptr<NodeTopology> m_NodeTopology;
+        /// Staging space for the centroids on their way to the node's ranks (at startup, and after every hierarchical
+        /// reduction), in the leader's piece, and empty everywhere else. Every rank copies out of it into its own
+        /// matrices, and the kernels only ever read those.
+        std::unique_ptr<SharedWindow> m_NodeCentroids;
+        std::unique_ptr<CentroidReducer> m_CentroidReducer;
+        bool m_NodeSharedMemory = false;
+        bool m_ShardedCentroids = false;
+        /// The total number of centroids, when they are sharded
+        size_t m_NumCentroids = 0;
+        /// This rank's block of the centroids, when they are sharded
+        RowPartition m_CentroidShard{0, 0};
+        /// The iteration to start from, non-zero when resuming
+        size_t m_StartIteration = 0;
+        MiniBatchConvergence m_MiniBatchConvergence;
+        size_t m_CheckpointInterval = 0;
+        /// Only on the main rank
+        std::unique_ptr<AsyncCheckpointWriter> m_CheckpointWriter;
+        AssignmentBackend m_AssignmentBackend = AssignmentBackend::PerPoint;
+        size_t m_YinyangGroupCount = 0;
+        double m_RebalanceThreshold = 0.0;
+        size_t m_IterationsSinceRebalance = 0;
+        size_t m_RebalanceCount = 0;
+        double m_ImbalanceSum = 0.0;
+        size_t m_ImbalanceSamples = 0;
 
 
     };
@@ -0,0 +1,85 @@
+//
+// Created by Matthew Krueger on 11/6/25.
+//
+
+#include "NodeTopology.hpp"
+
+#include <stdexcept>
+
+#include "../shared/Instrumentation.hpp"
+
+namespace kmeans {
+
+    NodeTopology::NodeTopology(MPI_Comm communicator) {
+        PROFILE_FUNCTION();
+
+        int rank = 0;
+        MPI_Comm_rank(communicator, &rank);
+
+        // keyed by our rank in the parent, so the node order follows it, and parent rank 0 is node rank 0
+        MPI_Comm_split_type(communicator, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &m_NodeCommunicator);
+        MPI_Comm_rank(m_NodeCommunicator, &m_NodeRank);
+        MPI_Comm_size(m_NodeCommunicator, &m_NodeSize);
+
+        // the leaders get a communicator of their own. Everyone else has to take part in the split, but gets nothing.
+        MPI_Comm_split(communicator, isLeader() ? 0 : MPI_UNDEFINED, rank, &m_LeaderCommunicator);
+        if (isLeader()) {
+            MPI_Comm_size(m_LeaderCommunicator, &m_NumNodes);
+        }
+        MPI_Bcast(&m_NumNodes, 1, MPI_INT, 0, m_NodeCommunicator);
+    }
+
+    NodeTopology::~NodeTopology() {
+        if (m_LeaderCommunicator != MPI_COMM_NULL) {
+            MPI_Comm_free(&m_LeaderCommunicator);
+        }
+        if (m_NodeCommunicator != MPI_COMM_NULL) {
+            MPI_Comm_free(&m_NodeCommunicator);
+        }
+    }
+
+    SharedWindow::SharedWindow(MPI_Comm nodeCommunicator, const size_t localBytes) : m_NodeCommunicator(nodeCommunicator), m_LocalSize(localBytes) {
+        PROFILE_FUNCTION();
+
+        void* base = nullptr;
+        const int result = MPI_Win_allocate_shared(static_cast<MPI_Aint>(localBytes), 1, MPI_INFO_NULL, nodeCommunicator, &base, &m_Window);
+        if (result != MPI_SUCCESS) {
+            throw std::runtime_error("Cannot allocate a shared memory window");
+        }
+        m_Local = static_cast<std::byte*>(base);
+
+        // one long passive epoch. Nobody ever uses RMA calls on it, just loads, stores and synchronize()
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, m_Window);
+    }
+
+    SharedWindow::~SharedWindow() {
+        if (m_Window != MPI_WIN_NULL) {
+            MPI_Win_unlock_all(m_Window);
+            MPI_Win_free(&m_Window);
+        }
+    }
+
+    std::byte* SharedWindow::of(const int nodeRank) const {
+        MPI_Aint size = 0;
+        int displacementUnit = 0;
+        void* base = nullptr;
+        MPI_Win_shared_query(m_Window, nodeRank, &size, &displacementUnit, &base);
+        return static_cast<std::byte*>(base);
+    }
+
+    size_t SharedWindow::sizeOf(const int nodeRank) const {
+        MPI_Aint size = 0;
+        int displacementUnit = 0;
+        void* base = nullptr;
+        MPI_Win_shared_query(m_Window, nodeRank, &size, &displacementUnit, &base);
+        return static_cast<size_t>(size);
+    }
+
+    void SharedWindow::synchronize() const {
+        // the usual fence for the unified memory model: flush our stores, wait for everyone, then see theirs
+        MPI_Win_sync(m_Window);
+        MPI_Barrier(m_NodeCommunicator);
+        MPI_Win_sync(m_Window);
+    }
+
+} // kmeans
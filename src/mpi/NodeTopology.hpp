@@ -0,0 +1,99 @@
+//
+// Created by Matthew Krueger on 11/6/25.
+//
+
+#ifndef KMEANS_MPI_NODETOPOLOGY_HPP
+#define KMEANS_MPI_NODETOPOLOGY_HPP
+
+#include <cstddef>
+#include <mpi.h>
+
+namespace kmeans {
+
+    /**
+     * @brief How a communicator's ranks sit on the machine's nodes.
+     *
+     * The ranks are split into one communicator per shared-memory node (MPI_Comm_split_type), ordered by their rank in
+     * the parent, and the first rank of every node (its leader) also joins a communicator of just the leaders. Rank 0
+     * of the parent is always a leader, and always rank 0 of the leaders.
+     *
+     * Creating one is collective over the parent communicator. Both communicators are freed when it is destroyed.
+     */
+    class NodeTopology {
+    public:
+        explicit NodeTopology(MPI_Comm communicator);
+        NodeTopology(const NodeTopology&) = delete;
+        NodeTopology& operator=(const NodeTopology&) = delete;
+        ~NodeTopology();
+
+        /// The ranks on this node
+        [[nodiscard]] inline MPI_Comm nodeCommunicator() const { return m_NodeCommunicator; }
+        /// One rank per node. MPI_COMM_NULL on every rank that isn't a leader.
+        [[nodiscard]] inline MPI_Comm leaderCommunicator() const { return m_LeaderCommunicator; }
+
+        [[nodiscard]] inline int nodeRank() const { return m_NodeRank; }
+        [[nodiscard]] inline int nodeSize() const { return m_NodeSize; }
+        [[nodiscard]] inline bool isLeader() const { return m_NodeRank == 0; }
+        [[nodiscard]] inline int numNodes() const { return m_NumNodes; }
+
+    private:
+        MPI_Comm m_NodeCommunicator = MPI_COMM_NULL;
+        MPI_Comm m_LeaderCommunicator = MPI_COMM_NULL;
+        int m_NodeRank = 0;
+        int m_NodeSize = 1;
+        int m_NumNodes = 1;
+    };
+
+    /**
+     * @brief One MPI_Win_allocate_shared segment spread across the ranks of a node.
+     *
+     * Every rank asks for its own piece, and the pieces are laid out back to back in rank order, so the whole node's
+     * data is one contiguous block that any rank on the node can read (or write) with plain loads and stores. The window
+     * stays locked for passive access for its whole life. synchronize() is the only fence anybody needs.
+     *
+     * Creating and destroying one are both collective over the node communicator.
+     */
+    class SharedWindow {
+    public:
+        /**
+         * @brief Allocates the segment.
+         * @param nodeCommunicator The ranks that share it. Must all be on one node.
+         * @param localBytes The size of this rank's piece. May be zero, and may differ between ranks.
+         * @throws std::runtime_error if the window can't be allocated
+         */
+        SharedWindow(MPI_Comm nodeCommunicator, size_t localBytes);
+        SharedWindow(const SharedWindow&) = delete;
+        SharedWindow& operator=(const SharedWindow&) = delete;
+        ~SharedWindow();
+
+        /// This rank's piece
+        [[nodiscard]] inline std::byte* local() const { return m_Local; }
+        [[nodiscard]] inline size_t localSize() const { return m_LocalSize; }
+
+        /**
+         * @brief Gets the piece of another rank on the node, as mapped into this process.
+         * @param nodeRank The rank, in the node communicator
+         */
+        [[nodiscard]] std::byte* of(int nodeRank) const;
+
+        /**
+         * @brief Gets the size, in bytes, of another rank's piece.
+         * @param nodeRank The rank, in the node communicator
+         */
+        [[nodiscard]] size_t sizeOf(int nodeRank) const;
+
+        /**
+         * @brief Makes every store before it, on any rank of the node, visible to every load after it. Collective.
+         */
+        void synchronize() const;
+
+    private:
+        MPI_Comm m_NodeCommunicator;
+        MPI_Win m_Window = MPI_WIN_NULL;
+        std::byte* m_Local = nullptr;
+        size_t m_LocalSize = 0;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_NODETOPOLOGY_HPP
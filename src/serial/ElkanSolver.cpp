@@ -0,0 +1,16 @@
+//
+// Created by Matthew Krueger on 10/27/25.
+//
+
+#include "ElkanSolver.hpp"
+
+namespace kmeans {
+
+    ElkanSolver::ElkanSolver(Config &config) : SerialSolver(useElkanBackend(config)) {}
+
+    SerialSolver::Config &ElkanSolver::useElkanBackend(Config &config) {
+        config.assignmentBackend = AssignmentBackend::Elkan;
+        return config;
+    }
+
+} // kmeans
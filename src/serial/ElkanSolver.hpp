@@ -0,0 +1,28 @@
+//
+// Created by Matthew Krueger on 10/27/25.
+//
+
+#ifndef KMEANS_MPI_ELKANSOLVER_HPP
+#define KMEANS_MPI_ELKANSOLVER_HPP
+
+#include "SerialSolver.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief A SerialSolver that always uses Elkan's triangle inequality accelerated assignment.
+     *
+     * The iteration itself is exactly the SerialSolver one; only the assignment step differs (see ElkanAssignmentEngine).
+     * This is equivalent to constructing a SerialSolver with assignmentBackend = AssignmentBackend::Elkan.
+     */
+    class ElkanSolver : public SerialSolver {
+    public:
+        explicit ElkanSolver(Config &config);
+
+    private:
+        static Config& useElkanBackend(Config &config);
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_ELKANSOLVER_HPP
@@ -6,9 +6,11 @@
 
 #include <algorithm>
 #include <ranges>
+#include <sstream>
 #include <unordered_set>
 
 #include "../shared/Logging.hpp"
+#include "../shared/MiniBatch.hpp"
 
 #include "../shared/Utils.hpp"
 
@@ -31,16 +33,37 @@ namespace kmeans {
         // copy config appropriately.
         m_MaxIterations = config.maxIterations;
         m_ConvergenceThreshold = config.convergenceThreshold;
-        m_CurrentCentroids = std::vector<Point>();
+        m_AssignmentEngine = AssignmentEngine::create(config.assignmentBackend, config.yinyangGroupCount);
+        m_ThreadPool = std::make_unique<ThreadPool>(config.numThreads);
+        m_MiniBatchSize = config.miniBatchSize;
+        // offset from the centroid seed, so the batches aren't drawn from the same stream that picked the centroids
+        m_MiniBatchRng.seed(config.startingCentroidSeed + 1);
 
-        size_t dimensionality = m_DataSet[0].numDimensions();
+        size_t dimensionality = m_DataSet.numDimensions();
         size_t numCentroids = config.startingCentroidCount;
         size_t seed = config.startingCentroidSeed;
 
-        // reserve space for centroids appropriately. No need to reserve previous as it'll get dumped anyway as soon as we start the run
-        m_CurrentCentroids.reserve(config.startingCentroidCount);
+        // both centroid buffers are allocated once here, and are swapped back and forth every iteration from then on
+        m_CurrentCentroids = CentroidMatrix(numCentroids, dimensionality);
+        m_PreviousCentroids = CentroidMatrix(numCentroids, dimensionality);
 
-        {
+        if (config.resume) {
+            // a checkpoint already has the centroids (and the batch RNG) from where the last run left off
+            Checkpoint checkpoint = readCheckpoint(config.checkpointPath);
+            if (checkpoint.centroids.numCentroids() != numCentroids || checkpoint.centroids.numDimensions() != dimensionality) {
+                throw std::invalid_argument("The checkpoint doesn't match the number of clusters or dimensions");
+            }
+            m_CurrentCentroids = std::move(checkpoint.centroids);
+            m_StartIteration = checkpoint.nextIteration;
+            m_MiniBatchConvergence = MiniBatchConvergence(checkpoint.miniBatchConvergence);
+            if (!checkpoint.rngStates.empty()) {
+                std::istringstream(checkpoint.rngStates.front()) >> m_MiniBatchRng;
+            }
+        } else if (config.initializationMethod == InitializationMethod::KMeansPlusPlus) {
+            // D^2 seeding costs about one extra iteration, and usually saves several
+            std::mt19937 rng(seed);
+            m_CurrentCentroids = kMeansPlusPlus(m_DataSet.getPoints(), {}, numCentroids, rng);
+        } else {
             // now, we generate our centroids
             DEBUG_PRINT("Copied Solver Configs");
 
@@ -56,12 +79,18 @@ namespace kmeans {
                 indices.emplace(index);
             }
 
+            // explicitly copy the data into the centroid rows so we know *FOR SURE* it's unique.
+            size_t centroid = 0;
+            for (const size_t index : indices) {
+                std::ranges::copy(m_DataSet[index], m_CurrentCentroids.row(centroid));
+                m_CurrentCentroids.setCount(centroid, 1.0);
+                ++centroid;
+            }
+        }
 
-            std::ranges::transform(indices,
-                                   std::back_inserter(m_CurrentCentroids),
-                                   [&](const size_t index) { return Point(m_DataSet[index]); }
-                                   // explicitly copy the data so we know *FOR SURE* it's unique.
-            );
+        m_CheckpointInterval = config.checkpointInterval;
+        if (m_CheckpointInterval > 0 && !config.checkpointPath.empty()) {
+            m_CheckpointWriter = std::make_unique<AsyncCheckpointWriter>(config.checkpointPath);
         }
     }
 
@@ -69,11 +98,16 @@ namespace kmeans {
     void SerialSolver::run() {
         PROFILE_FUNCTION();
 
+        if (m_MiniBatchSize > 0) {
+            runMiniBatch();
+            return;
+        }
+
         // so the algorithm is roughly this
         // Calculates the *closest* centroid and class the point as this centroid
         // Then calculate the vector average of all the points
         // the vector average becomes the new
-        size_t iteration = 0;
+        size_t iteration = m_StartIteration;
         while (iteration < m_MaxIterations) {
             // test if we have reached convergence or max samples
             PROFILE_SCOPE("Iteration");
@@ -82,55 +116,34 @@ namespace kmeans {
             // in each iteration, we have to class the centroid, then accumulate the centroid to the new average. Generally speaking,
             // while this class -> reduction operation is two separate operations, in this case it may be advantageous to interleave these operations
 
-            // Ergo, we will reserve a new array of current centroids and move the old one to previous
-            m_PreviousCentroids = std::move(m_CurrentCentroids);
+            // Ergo, we swap the current centroids into previous. Swapping rather than reallocating means the two
+            // centroid buffers are reused for the entire run.
+            std::swap(m_PreviousCentroids, m_CurrentCentroids);
 
-            // and zero the new one AND
-            // since m_CurrentCentroids has counts, we can fill the vector with zero
-            //m_CurrentCentroids = std::vector<Point>(m_PreviousCentroids.size(), Point(std::vector<double>(m_DataSet[0].numDimensions(), 0.0), 0));
+            // and zero the new one, sums and counts alike
+            m_CurrentCentroids.zero();
 
             // now that we have that, we can now accumulate
-            // again, this uses move semantics to pass the *same* value back and forth,
-            // so the accumulation is a zero cost abstraction that matches the reduction pattern more closely
-            // than "just" a for loop
-            m_CurrentCentroids = std::accumulate(
-                m_DataSet.begin(),
-                m_DataSet.end(),
-                std::vector<Point>(m_PreviousCentroids.size(),
-                                   Point(std::vector<double>(m_DataSet[0].numDimensions(), 0.0), 0)),
-                [&](std::vector<Point> acc, Point &point) {
-                    PROFILE_SCOPE("Accumulate");
-                    auto closestCentroidInPrevious = point.findClosestPointInVector(m_PreviousCentroids);
-
-                    if (closestCentroidInPrevious != m_PreviousCentroids.end()) {
-                        size_t centroidIndex = std::distance(m_PreviousCentroids.begin(), closestCentroidInPrevious);
-                        acc[centroidIndex] += point;
-                        acc[centroidIndex].setCount(acc[centroidIndex].getCount() + 1);
-                        return acc;
-                    } else {
-                        throw std::runtime_error("Centroid not found in previous centroids");
-                    }
-                }
-            );
+            // the assignment engine classes every point against the previous centroids and adds it to the current sums,
+            // with the rows split across the thread pool
+            assignAcrossThreads(*m_AssignmentEngine, *m_ThreadPool, m_DataSet.getPoints(), m_PreviousCentroids, m_ThreadSums, m_CurrentCentroids);
 
             // transform the m_CurrentCentroids by the scalar
             // so that we have the actual average
-            std::ranges::for_each(m_CurrentCentroids, [](Point &centroid) {
-                if (centroid.getCount() > 0) {
-                    centroid /= static_cast<double>(centroid.getCount());
-                }
-                // If getCount() is 0, the centroid sum is already {0,0,...}, which is correct for an empty cluster.
-            });
+            // If a count is 0, the centroid sum is already {0,0,...}, which is correct for an empty cluster.
+            m_CurrentCentroids.finalize();
 
             // now we can check if the centroids have stabilized. If they have, we'll break
             if (areCentroidsConverged(m_PreviousCentroids, m_CurrentCentroids, m_ConvergenceThreshold)) {
                 break;
             }
 
+            checkpointIfDue(iteration + 1);
+
             // now we're done with an iteration.
             if constexpr (DEBUG_FLAG) {
                 std::cout << "Iteration " << iteration << std::endl;
-                for (auto &centroid: m_CurrentCentroids) {
+                for (auto &centroid: m_CurrentCentroids.toPoints()) {
                     std::cout << centroid << std::endl;
                 }
             }
@@ -139,7 +152,60 @@ namespace kmeans {
         }
 
         m_FinalIterationCount = iteration;
-        m_CalculatedCentroidsAtCompletion = m_CurrentCentroids;
+        m_CalculatedCentroidsAtCompletion = m_CurrentCentroids.toPoints();
         DEBUG_PRINT("Centroids are converged, or terminated due to too many iterations");
     }
+
+    void SerialSolver::runMiniBatch() {
+        PROFILE_FUNCTION();
+
+        // mini-batch k-means doesn't rebuild the centroids from scratch every iteration. It nudges them, so instead of
+        // double buffering, the previous centroids are just a copy kept for the convergence check, and the batch gets
+        // its own accumulator. The counts in m_CurrentCentroids are the running totals the learning rates come from.
+        CentroidMatrix batchSums(m_CurrentCentroids.numCentroids(), m_CurrentCentroids.numDimensions());
+        const PointMatrix &points = m_DataSet.getPoints();
+
+        size_t iteration = m_StartIteration;
+        while (iteration < m_MaxIterations) {
+            PROFILE_SCOPE("Iteration");
+            DEBUG_PRINT("SerialSolver mini-batch iteration " << iteration << " of " << m_MaxIterations);
+
+            m_PreviousCentroids = m_CurrentCentroids;
+            batchSums.zero();
+
+            const double inertia = accumulateMiniBatch(points, m_CurrentCentroids, m_MiniBatchSize, m_MiniBatchRng, batchSums);
+            m_CurrentCentroids.applyMiniBatch(batchSums);
+
+            // the step size shrinks as the counts grow, so this does settle, just not to exactly Lloyd's answer.
+            // Either the centroids really stopped, or the batches stopped getting any better.
+            const bool stalled = m_MiniBatchConvergence.update(inertia, static_cast<double>(m_MiniBatchSize));
+            if (stalled || areCentroidsConverged(m_PreviousCentroids, m_CurrentCentroids, m_ConvergenceThreshold)) {
+                break;
+            }
+
+            checkpointIfDue(iteration + 1);
+
+            iteration++;
+        }
+
+        m_FinalIterationCount = iteration;
+        m_CalculatedCentroidsAtCompletion = m_CurrentCentroids.toPoints();
+        DEBUG_PRINT("Mini-batch centroids are converged, or terminated due to too many iterations");
+    }
+
+    void SerialSolver::checkpointIfDue(const size_t completedIterations) {
+        if (!m_CheckpointWriter || completedIterations % m_CheckpointInterval != 0) {
+            return;
+        }
+        PROFILE_FUNCTION();
+
+        // the copy of the centroids is all the iteration pays for. The writer thread does the rest
+        Checkpoint checkpoint{completedIterations, m_CurrentCentroids, {}, m_MiniBatchConvergence.getState()};
+        if (m_MiniBatchSize > 0) {
+            std::ostringstream state;
+            state << m_MiniBatchRng;
+            checkpoint.rngStates.push_back(state.str());
+        }
+        m_CheckpointWriter->submit(std::move(checkpoint));
+    }
 } // kmeans
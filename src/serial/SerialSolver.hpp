@@ -5,7 +5,15 @@
 #ifndef KMEANS_MPI_SERIALSOLVER_HPP
 #define KMEANS_MPI_SERIALSOLVER_HPP
 
+#include <filesystem>
+#include <random>
+
+#include "../shared/AssignmentEngine.hpp"
+#include "../shared/Checkpoint.hpp"
 #include "../shared/DataSet.hpp"
+#include "../shared/Initialization.hpp"
+#include "../shared/PointMatrix.hpp"
+#include "../shared/ThreadPool.hpp"
 
 namespace kmeans {
     class SerialSolver {
@@ -16,6 +24,19 @@ namespace kmeans {
             DataSet dataSet;
             size_t startingCentroidSeed;
             size_t startingCentroidCount;
+            AssignmentBackend assignmentBackend = AssignmentBackend::PerPoint;
+            size_t yinyangGroupCount = 0;
+            /// If non-zero, run mini-batch k-means, sampling this many points per iteration, instead of full Lloyd
+            size_t miniBatchSize = 0;
+            InitializationMethod initializationMethod = InitializationMethod::Random;
+            /// Threads per process, including the calling one. Zero means one per hardware thread.
+            size_t numThreads = 1;
+            /// Where checkpoints are written to, and resumed from
+            std::filesystem::path checkpointPath;
+            /// If non-zero (and checkpointPath is set), write a checkpoint every this many iterations, in the background
+            size_t checkpointInterval = 0;
+            /// If true, start from the checkpoint at checkpointPath instead of picking starting centroids
+            bool resume = false;
         };
 
         SerialSolver() = default;
@@ -35,13 +56,34 @@ namespace kmeans {
         inline const std::optional<size_t>& getFinalIterationCount() const { return m_FinalIterationCount; }
 
     private:
+        /**
+         * @brief The mini-batch counterpart of run(). Each iteration samples a batch rather than visiting every point.
+         */
+        void runMiniBatch();
+
+        /**
+         * @brief Hands a checkpoint to the writer, if this is an iteration that should have one.
+         * @param completedIterations How many iterations have been run so far, including the one just finished
+         */
+        void checkpointIfDue(size_t completedIterations);
+
         DataSet m_DataSet;
-        std::vector<Point> m_CurrentCentroids;
-        std::vector<Point> m_PreviousCentroids;
+        CentroidMatrix m_CurrentCentroids;
+        CentroidMatrix m_PreviousCentroids;
         size_t m_MaxIterations;
         double m_ConvergenceThreshold;
         std::optional<std::vector<Point>> m_CalculatedCentroidsAtCompletion = std::nullopt;
         std::optional<size_t> m_FinalIterationCount = std::nullopt;
+        std::unique_ptr<AssignmentEngine> m_AssignmentEngine;
+        std::unique_ptr<ThreadPool> m_ThreadPool;
+        std::vector<CentroidMatrix> m_ThreadSums;
+        size_t m_MiniBatchSize = 0;
+        std::mt19937 m_MiniBatchRng;
+        /// The iteration to start from, non-zero when resuming
+        size_t m_StartIteration = 0;
+        MiniBatchConvergence m_MiniBatchConvergence;
+        size_t m_CheckpointInterval = 0;
+        std::unique_ptr<AsyncCheckpointWriter> m_CheckpointWriter;
 
 
     };
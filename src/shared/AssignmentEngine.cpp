@@ -0,0 +1,104 @@
+//
+// Created by Matthew Krueger on 10/26/25.
+//
+
+#include "AssignmentEngine.hpp"
+
+#include <stdexcept>
+
+#include "AssignmentKernel.hpp"
+#include "BlockedAssignment.hpp"
+#include "ElkanAssignment.hpp"
+#include "HamerlyAssignment.hpp"
+#include "YinyangAssignment.hpp"
+#include "Instrumentation.hpp"
+
+namespace kmeans {
+
+    AssignmentBackend parseAssignmentBackend(const std::string &name) {
+        if (name == "per-point") {
+            return AssignmentBackend::PerPoint;
+        }
+        if (name == "blocked") {
+            return AssignmentBackend::Blocked;
+        }
+        if (name == "elkan") {
+            return AssignmentBackend::Elkan;
+        }
+        if (name == "hamerly") {
+            return AssignmentBackend::Hamerly;
+        }
+        if (name == "yinyang") {
+            return AssignmentBackend::Yinyang;
+        }
+        throw std::invalid_argument("Unknown assignment backend: " + name);
+    }
+
+    const char* getAssignmentBackendName(const AssignmentBackend backend) {
+        switch (backend) {
+            case AssignmentBackend::PerPoint: return "per-point";
+            case AssignmentBackend::Blocked: return "blocked";
+            case AssignmentBackend::Elkan: return "elkan";
+            case AssignmentBackend::Hamerly: return "hamerly";
+            case AssignmentBackend::Yinyang: return "yinyang";
+        }
+        return "unknown";
+    }
+
+    std::unique_ptr<AssignmentEngine> AssignmentEngine::create(const AssignmentBackend backend, const size_t yinyangGroupCount) {
+        switch (backend) {
+            case AssignmentBackend::PerPoint: return std::make_unique<PerPointAssignmentEngine>();
+            case AssignmentBackend::Blocked: return std::make_unique<BlockedAssignmentEngine>();
+            case AssignmentBackend::Elkan: return std::make_unique<ElkanAssignmentEngine>();
+            case AssignmentBackend::Hamerly: return std::make_unique<HamerlyAssignmentEngine>();
+            case AssignmentBackend::Yinyang: return std::make_unique<YinyangAssignmentEngine>(yinyangGroupCount);
+        }
+        throw std::invalid_argument("Unknown assignment backend");
+    }
+
+    void PerPointAssignmentEngine::assign(const PointMatrix &points, const CentroidMatrix &centroids, const size_t begin, const size_t end, CentroidMatrix &sums) {
+        // the dataset is one contiguous row-major matrix, so this walks memory linearly, point after point
+        for (size_t index = begin; index < end; ++index) {
+            PROFILE_SCOPE("Accumulate");
+            const double* point = points.row(index);
+            sums.accumulate(centroids.findClosestCentroid(point), point);
+        }
+    }
+
+    void assignAcrossThreads(AssignmentEngine &engine, ThreadPool &pool, const PointMatrix &points, const CentroidMatrix &centroids, std::vector<CentroidMatrix> &threadSums, CentroidMatrix &sums) {
+        PROFILE_FUNCTION();
+
+        engine.prepare(points, centroids);
+        assignRangeAcrossThreads(engine, pool, points, centroids, 0, points.numPoints(), threadSums, sums);
+    }
+
+    void assignRangeAcrossThreads(AssignmentEngine &engine, ThreadPool &pool, const PointMatrix &points, const CentroidMatrix &centroids, const size_t begin, const size_t end, std::vector<CentroidMatrix> &threadSums, CentroidMatrix &sums) {
+        const size_t numThreads = pool.size();
+        if (numThreads == 1) {
+            engine.assign(points, centroids, begin, end, sums);
+            return;
+        }
+
+        // one accumulator per extra thread, shaped like sums. They are only reallocated if the shape changes.
+        threadSums.resize(numThreads - 1);
+        for (CentroidMatrix &threadSum : threadSums) {
+            if (threadSum.numCentroids() != sums.numCentroids() || threadSum.numDimensions() != sums.numDimensions()) {
+                threadSum = CentroidMatrix(sums.numCentroids(), sums.numDimensions());
+            } else {
+                threadSum.zero();
+            }
+        }
+
+        const size_t numRows = end - begin;
+        pool.run([&](const size_t threadIndex) {
+            CentroidMatrix &target = (threadIndex == 0) ? sums : threadSums[threadIndex - 1];
+            engine.assign(points, centroids, begin + pool.sliceBegin(threadIndex, numRows), begin + pool.sliceBegin(threadIndex + 1, numRows), target);
+        });
+
+        // and fold the extra threads into sums, in thread order so the result doesn't depend on who finished first
+        for (const CentroidMatrix &threadSum : threadSums) {
+            sums += threadSum;
+        }
+    }
+
+} // kmeans
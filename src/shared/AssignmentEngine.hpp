@@ -0,0 +1,125 @@
+//
+// Created by Matthew Krueger on 10/26/25.
+//
+
+#ifndef KMEANS_MPI_ASSIGNMENTENGINE_HPP
+#define KMEANS_MPI_ASSIGNMENTENGINE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PointMatrix.hpp"
+#include "ThreadPool.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief Selects how the assignment step (class every point to its closest centroid, and accumulate it) is computed.
+     */
+    enum class AssignmentBackend {
+        /// One point at a time through kernel::findNearestCentroid. Best for small k.
+        PerPoint,
+        /// Tiles of points against tiles of centroids with the ||x||^2 - 2x.c + ||c||^2 expansion. Best for large k and d.
+        Blocked,
+        /// Exact, with per-point upper and per-centroid lower bounds to skip most distances (Elkan). O(n * k) memory.
+        Elkan,
+        /// Exact, with one upper and one lower bound per point (Hamerly). O(n) memory, best for low to medium d.
+        Hamerly,
+        /// Exact, with one lower bound per group of centroids (Yinyang). O(n * t) memory, best for very large k.
+        Yinyang
+    };
+
+    /**
+     * @brief Parses a backend from its command line name.
+     * @param name One of "per-point", "blocked", "elkan", "hamerly" or "yinyang"
+     * @return The backend
+     * @throws std::invalid_argument if the name is not recognized
+     */
+    AssignmentBackend parseAssignmentBackend(const std::string& name);
+
+    /**
+     * @brief Gets the command line name of a backend.
+     */
+    const char* getAssignmentBackendName(AssignmentBackend backend);
+
+    /**
+     * @brief The assignment step of an iteration, behind an interface so the solvers can swap how it is computed.
+     *
+     * Every iteration, a solver calls prepare() exactly once with the centroids from the previous iteration, and then
+     * assign() one or more times over disjoint row ranges of the same points. Splitting it this way lets an engine do its
+     * per-iteration setup once (norms, packing, bounds) and lets the solver hand out the rows however it likes.
+     */
+    class AssignmentEngine {
+    public:
+        AssignmentEngine() = default;
+        AssignmentEngine(const AssignmentEngine&) = delete;
+        AssignmentEngine& operator=(const AssignmentEngine&) = delete;
+        virtual ~AssignmentEngine() = default;
+
+        /**
+         * @brief Does whatever per-iteration work the engine needs before points can be classed.
+         * @param points The points that will be classed this iteration
+         * @param centroids The centroids to class against
+         */
+        virtual void prepare(const PointMatrix& points, const CentroidMatrix& centroids) = 0;
+
+        /**
+         * @brief Classes the rows [begin, end) of points, and accumulates each one into sums.
+         * @param points The same points that were given to prepare()
+         * @param centroids The same centroids that were given to prepare()
+         * @param begin The first row to class
+         * @param end One past the last row to class
+         * @param sums The accumulator the classed points are added to
+         */
+        virtual void assign(const PointMatrix& points, const CentroidMatrix& centroids, size_t begin, size_t end, CentroidMatrix& sums) = 0;
+
+        /**
+         * @brief Creates an engine.
+         * @param backend Which engine to create
+         * @param yinyangGroupCount The number of centroid groups for the Yinyang engine. Zero picks k / 10. Ignored by the others.
+         * @return The engine
+         */
+        static std::unique_ptr<AssignmentEngine> create(AssignmentBackend backend, size_t yinyangGroupCount = 0);
+    };
+
+    /**
+     * @brief Plain Lloyd assignment: every point against every centroid through the SIMD kernel.
+     */
+    class PerPointAssignmentEngine final : public AssignmentEngine {
+    public:
+        void prepare(const PointMatrix&, const CentroidMatrix&) override {}
+        void assign(const PointMatrix& points, const CentroidMatrix& centroids, size_t begin, size_t end, CentroidMatrix& sums) override;
+    };
+
+    /**
+     * @brief Runs a whole assignment step (prepare, then assign) with the rows split across the threads of a pool.
+     *
+     * Thread 0 accumulates straight into sums, and every other thread into its own accumulator, which is added into
+     * sums once all threads are done. Each accumulator is its own cache line aligned allocation, so no two threads ever
+     * write to the same line. With a pool of one thread this is exactly engine.prepare() plus one engine.assign().
+     *
+     * Every engine only writes per-row state in assign(), so disjoint row slices are safe to run concurrently.
+     *
+     * @param engine The engine to run
+     * @param pool The threads to run it on
+     * @param points The points to class
+     * @param centroids The centroids to class against
+     * @param threadSums Scratch accumulators for threads 1 and up. Resized and zeroed as needed, and meant to be kept
+     * across iterations so they are only allocated once.
+     * @param sums The accumulator the classed points end up in. Expected to be zeroed by the caller.
+     */
+    void assignAcrossThreads(AssignmentEngine& engine, ThreadPool& pool, const PointMatrix& points, const CentroidMatrix& centroids, std::vector<CentroidMatrix>& threadSums, CentroidMatrix& sums);
+
+    /**
+     * @brief The assign half of assignAcrossThreads(), over just the rows [begin, end), with no prepare().
+     *
+     * For callers that want to class the rows a piece at a time, e.g. to overlap each piece with communication.
+     * The engine must already have been prepared for this iteration.
+     */
+    void assignRangeAcrossThreads(AssignmentEngine& engine, ThreadPool& pool, const PointMatrix& points, const CentroidMatrix& centroids, size_t begin, size_t end, std::vector<CentroidMatrix>& threadSums, CentroidMatrix& sums);
+
+} // kmeans
+
+#endif //KMEANS_MPI_ASSIGNMENTENGINE_HPP
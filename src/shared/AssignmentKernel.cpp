@@ -0,0 +1,216 @@
+//
+// Created by Matthew Krueger on 10/25/25.
+//
+
+#include "AssignmentKernel.hpp"
+
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace kmeans::kernel {
+
+    namespace {
+
+        /**
+         * @brief Folds four candidate distances into the running best, in index order so ties go to the lowest index.
+         */
+        inline void updateNearest(NearestCentroid &nearest, const size_t firstIndex, const double d0, const double d1, const double d2, const double d3) {
+            if (d0 < nearest.squaredDistance) { nearest = {firstIndex, d0}; }
+            if (d1 < nearest.squaredDistance) { nearest = {firstIndex + 1, d1}; }
+            if (d2 < nearest.squaredDistance) { nearest = {firstIndex + 2, d2}; }
+            if (d3 < nearest.squaredDistance) { nearest = {firstIndex + 3, d3}; }
+        }
+
+        inline double scalarSquaredDistance(const double* lhs, const double* rhs, const size_t numDimensions) {
+            double sum = 0.0;
+            for (size_t dimension = 0; dimension < numDimensions; ++dimension) {
+                const double difference = lhs[dimension] - rhs[dimension];
+                sum += difference * difference;
+            }
+            return sum;
+        }
+
+#if defined(__AVX512F__)
+
+        inline double vectorSquaredDistance(const double* lhs, const double* rhs, const size_t numDimensions) {
+            __m512d accumulator = _mm512_setzero_pd();
+            size_t dimension = 0;
+            for (; dimension + 8 <= numDimensions; dimension += 8) {
+                const __m512d difference = _mm512_sub_pd(_mm512_loadu_pd(lhs + dimension), _mm512_loadu_pd(rhs + dimension));
+                accumulator = _mm512_fmadd_pd(difference, difference, accumulator);
+            }
+            if (dimension < numDimensions) {
+                // masked loads read only the tail, so we never touch memory past the end of the row
+                const __mmask8 mask = static_cast<__mmask8>((1u << (numDimensions - dimension)) - 1u);
+                const __m512d difference = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, lhs + dimension), _mm512_maskz_loadu_pd(mask, rhs + dimension));
+                accumulator = _mm512_fmadd_pd(difference, difference, accumulator);
+            }
+            return _mm512_reduce_add_pd(accumulator);
+        }
+
+        inline void fourSquaredDistances(const double* point, const double* c0, const size_t numDimensions, double &d0, double &d1, double &d2, double &d3) {
+            const double* c1 = c0 + numDimensions;
+            const double* c2 = c1 + numDimensions;
+            const double* c3 = c2 + numDimensions;
+
+            __m512d a0 = _mm512_setzero_pd();
+            __m512d a1 = _mm512_setzero_pd();
+            __m512d a2 = _mm512_setzero_pd();
+            __m512d a3 = _mm512_setzero_pd();
+
+            size_t dimension = 0;
+            for (; dimension + 8 <= numDimensions; dimension += 8) {
+                const __m512d p = _mm512_loadu_pd(point + dimension);
+                const __m512d e0 = _mm512_sub_pd(p, _mm512_loadu_pd(c0 + dimension));
+                const __m512d e1 = _mm512_sub_pd(p, _mm512_loadu_pd(c1 + dimension));
+                const __m512d e2 = _mm512_sub_pd(p, _mm512_loadu_pd(c2 + dimension));
+                const __m512d e3 = _mm512_sub_pd(p, _mm512_loadu_pd(c3 + dimension));
+                a0 = _mm512_fmadd_pd(e0, e0, a0);
+                a1 = _mm512_fmadd_pd(e1, e1, a1);
+                a2 = _mm512_fmadd_pd(e2, e2, a2);
+                a3 = _mm512_fmadd_pd(e3, e3, a3);
+            }
+            if (dimension < numDimensions) {
+                const __mmask8 mask = static_cast<__mmask8>((1u << (numDimensions - dimension)) - 1u);
+                const __m512d p = _mm512_maskz_loadu_pd(mask, point + dimension);
+                const __m512d e0 = _mm512_sub_pd(p, _mm512_maskz_loadu_pd(mask, c0 + dimension));
+                const __m512d e1 = _mm512_sub_pd(p, _mm512_maskz_loadu_pd(mask, c1 + dimension));
+                const __m512d e2 = _mm512_sub_pd(p, _mm512_maskz_loadu_pd(mask, c2 + dimension));
+                const __m512d e3 = _mm512_sub_pd(p, _mm512_maskz_loadu_pd(mask, c3 + dimension));
+                a0 = _mm512_fmadd_pd(e0, e0, a0);
+                a1 = _mm512_fmadd_pd(e1, e1, a1);
+                a2 = _mm512_fmadd_pd(e2, e2, a2);
+                a3 = _mm512_fmadd_pd(e3, e3, a3);
+            }
+
+            d0 = _mm512_reduce_add_pd(a0);
+            d1 = _mm512_reduce_add_pd(a1);
+            d2 = _mm512_reduce_add_pd(a2);
+            d3 = _mm512_reduce_add_pd(a3);
+        }
+
+#elif defined(__AVX2__)
+
+        inline __m256d fusedSquareAdd(const __m256d difference, const __m256d accumulator) {
+#if defined(__FMA__)
+            return _mm256_fmadd_pd(difference, difference, accumulator);
+#else
+            return _mm256_add_pd(_mm256_mul_pd(difference, difference), accumulator);
+#endif
+        }
+
+        inline double horizontalSum(const __m256d value) {
+            const __m128d low = _mm256_castpd256_pd128(value);
+            const __m128d high = _mm256_extractf128_pd(value, 1);
+            const __m128d pair = _mm_add_pd(low, high);
+            return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+        }
+
+        inline double vectorSquaredDistance(const double* lhs, const double* rhs, const size_t numDimensions) {
+            __m256d accumulator = _mm256_setzero_pd();
+            size_t dimension = 0;
+            for (; dimension + 4 <= numDimensions; dimension += 4) {
+                const __m256d difference = _mm256_sub_pd(_mm256_loadu_pd(lhs + dimension), _mm256_loadu_pd(rhs + dimension));
+                accumulator = fusedSquareAdd(difference, accumulator);
+            }
+            return horizontalSum(accumulator) + scalarSquaredDistance(lhs + dimension, rhs + dimension, numDimensions - dimension);
+        }
+
+        inline void fourSquaredDistances(const double* point, const double* c0, const size_t numDimensions, double &d0, double &d1, double &d2, double &d3) {
+            const double* c1 = c0 + numDimensions;
+            const double* c2 = c1 + numDimensions;
+            const double* c3 = c2 + numDimensions;
+
+            __m256d a0 = _mm256_setzero_pd();
+            __m256d a1 = _mm256_setzero_pd();
+            __m256d a2 = _mm256_setzero_pd();
+            __m256d a3 = _mm256_setzero_pd();
+
+            size_t dimension = 0;
+            for (; dimension + 4 <= numDimensions; dimension += 4) {
+                const __m256d p = _mm256_loadu_pd(point + dimension);
+                a0 = fusedSquareAdd(_mm256_sub_pd(p, _mm256_loadu_pd(c0 + dimension)), a0);
+                a1 = fusedSquareAdd(_mm256_sub_pd(p, _mm256_loadu_pd(c1 + dimension)), a1);
+                a2 = fusedSquareAdd(_mm256_sub_pd(p, _mm256_loadu_pd(c2 + dimension)), a2);
+                a3 = fusedSquareAdd(_mm256_sub_pd(p, _mm256_loadu_pd(c3 + dimension)), a3);
+            }
+
+            // the tail is at most three dimensions, so it is not worth a masked load
+            const size_t remaining = numDimensions - dimension;
+            d0 = horizontalSum(a0) + scalarSquaredDistance(point + dimension, c0 + dimension, remaining);
+            d1 = horizontalSum(a1) + scalarSquaredDistance(point + dimension, c1 + dimension, remaining);
+            d2 = horizontalSum(a2) + scalarSquaredDistance(point + dimension, c2 + dimension, remaining);
+            d3 = horizontalSum(a3) + scalarSquaredDistance(point + dimension, c3 + dimension, remaining);
+        }
+
+#else
+
+        inline double vectorSquaredDistance(const double* lhs, const double* rhs, const size_t numDimensions) {
+            return scalarSquaredDistance(lhs, rhs, numDimensions);
+        }
+
+        inline void fourSquaredDistances(const double* point, const double* c0, const size_t numDimensions, double &d0, double &d1, double &d2, double &d3) {
+            const double* c1 = c0 + numDimensions;
+            const double* c2 = c1 + numDimensions;
+            const double* c3 = c2 + numDimensions;
+
+            // four independent chains, so the compiler (and the CPU) can overlap them
+            double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+            for (size_t dimension = 0; dimension < numDimensions; ++dimension) {
+                const double p = point[dimension];
+                const double e0 = p - c0[dimension];
+                const double e1 = p - c1[dimension];
+                const double e2 = p - c2[dimension];
+                const double e3 = p - c3[dimension];
+                s0 += e0 * e0;
+                s1 += e1 * e1;
+                s2 += e2 * e2;
+                s3 += e3 * e3;
+            }
+            d0 = s0; d1 = s1; d2 = s2; d3 = s3;
+        }
+
+#endif
+
+    }
+
+    const char* getInstructionSetName() {
+#if defined(__AVX512F__)
+        return "AVX-512";
+#elif defined(__AVX2__)
+        return "AVX2";
+#else
+        return "Scalar";
+#endif
+    }
+
+    double squaredEuclideanDistance(const double* lhs, const double* rhs, const size_t numDimensions) {
+        return vectorSquaredDistance(lhs, rhs, numDimensions);
+    }
+
+    NearestCentroid findNearestCentroid(const double* point, const double* centroids, const size_t numCentroids, const size_t numDimensions) {
+        NearestCentroid nearest{0, std::numeric_limits<double>::max()};
+
+        // four centroids at a time
+        size_t centroid = 0;
+        for (; centroid + 4 <= numCentroids; centroid += 4) {
+            double d0, d1, d2, d3;
+            fourSquaredDistances(point, centroids + centroid * numDimensions, numDimensions, d0, d1, d2, d3);
+            updateNearest(nearest, centroid, d0, d1, d2, d3);
+        }
+
+        // then whatever is left over, one at a time
+        for (; centroid < numCentroids; ++centroid) {
+            const double distance = vectorSquaredDistance(point, centroids + centroid * numDimensions, numDimensions);
+            if (distance < nearest.squaredDistance) {
+                nearest = {centroid, distance};
+            }
+        }
+
+        return nearest;
+    }
+
+} // kmeans::kernel
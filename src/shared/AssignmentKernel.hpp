@@ -0,0 +1,55 @@
+//
+// Created by Matthew Krueger on 10/25/25.
+//
+
+#ifndef KMEANS_MPI_ASSIGNMENTKERNEL_HPP
+#define KMEANS_MPI_ASSIGNMENTKERNEL_HPP
+
+#include <cstddef>
+
+namespace kmeans::kernel {
+
+    /**
+     * @brief The result of a nearest centroid search.
+     */
+    struct NearestCentroid {
+        /// The index of the closest centroid. Ties go to the lowest index.
+        size_t index;
+        /// The SQUARED Euclidean distance to that centroid. Take the sqrt yourself if you need the real distance.
+        double squaredDistance;
+    };
+
+    /**
+     * @brief Gets the name of the instruction set the kernels were compiled for ("AVX-512", "AVX2" or "Scalar").
+     *
+     * The path is picked at compile time from the target flags (we build with -march=native), so this is just for reporting.
+     */
+    const char* getInstructionSetName();
+
+    /**
+     * @brief Calculates the squared Euclidean distance between two points.
+     * @param lhs The first point, numDimensions long
+     * @param rhs The second point, numDimensions long
+     * @param numDimensions The number of dimensions of both points
+     * @return The sum of the squared differences
+     */
+    double squaredEuclideanDistance(const double* lhs, const double* rhs, size_t numDimensions);
+
+    /**
+     * @brief Finds the centroid closest to a point. This is the assignment step of Lloyd's algorithm, and thus the hot loop.
+     *
+     * Works entirely on squared distances (no sqrt, no pow), does no validation, and evaluates four centroids at once
+     * so that each load of the point is reused four times and there are four independent FMA chains in flight.
+     * There are explicit AVX-512 and AVX2 paths, and a scalar fallback with the same unrolling.
+     *
+     * @param point The point to class, numDimensions long
+     * @param centroids The row-major centroids, numCentroids * numDimensions long
+     * @param numCentroids The number of centroids. Must be at least one.
+     * @param numDimensions The number of dimensions of the point and of every centroid
+     * @return The index of, and the squared distance to, the closest centroid
+     */
+    NearestCentroid findNearestCentroid(const double* point, const double* centroids, size_t numCentroids, size_t numDimensions);
+
+} // kmeans::kernel
+
+#endif //KMEANS_MPI_ASSIGNMENTKERNEL_HPP
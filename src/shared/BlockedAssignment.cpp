@@ -0,0 +1,138 @@
+//
+// Created by Matthew Krueger on 10/26/25.
+//
+
+#include "BlockedAssignment.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "Instrumentation.hpp"
+
+namespace kmeans {
+
+    void BlockedAssignmentEngine::computePointNorms(const PointMatrix &points) {
+        PROFILE_FUNCTION();
+
+        m_PointNorms.resize(points.numPoints());
+        const size_t numDimensions = points.numDimensions();
+        for (size_t index = 0; index < points.numPoints(); ++index) {
+            const double* point = points.row(index);
+            double norm = 0.0;
+            for (size_t dimension = 0; dimension < numDimensions; ++dimension) {
+                norm += point[dimension] * point[dimension];
+            }
+            m_PointNorms[index] = norm;
+        }
+        m_PointNormsSource = points.data();
+    }
+
+    void BlockedAssignmentEngine::prepare(const PointMatrix &points, const CentroidMatrix &centroids) {
+        PROFILE_FUNCTION();
+
+        // the points never change over a run, so we only need their norms once
+        if (m_PointNormsSource != points.data() || m_PointNorms.size() != points.numPoints()) {
+            computePointNorms(points);
+        }
+
+        const size_t numCentroids = centroids.numCentroids();
+        const size_t numDimensions = centroids.numDimensions();
+        m_NumCentroidTiles = (numCentroids + CENTROID_TILE - 1) / CENTROID_TILE;
+
+        // pack the centroids dimension-major, tile by tile. The padding columns are zero, with an infinite norm.
+        m_PackedCentroids.assign(m_NumCentroidTiles * numDimensions * CENTROID_TILE, 0.0);
+        m_CentroidNorms.assign(m_NumCentroidTiles * CENTROID_TILE, std::numeric_limits<double>::infinity());
+
+        for (size_t centroid = 0; centroid < numCentroids; ++centroid) {
+            const size_t tile = centroid / CENTROID_TILE;
+            const size_t column = centroid % CENTROID_TILE;
+            const double* coordinates = centroids.row(centroid);
+            double* packedTile = m_PackedCentroids.data() + tile * numDimensions * CENTROID_TILE;
+
+            double norm = 0.0;
+            for (size_t dimension = 0; dimension < numDimensions; ++dimension) {
+                packedTile[dimension * CENTROID_TILE + column] = coordinates[dimension];
+                norm += coordinates[dimension] * coordinates[dimension];
+            }
+            m_CentroidNorms[centroid] = norm;
+        }
+    }
+
+    void BlockedAssignmentEngine::assign(const PointMatrix &points, const CentroidMatrix &, const size_t begin, const size_t end, CentroidMatrix &sums) {
+        PROFILE_FUNCTION();
+
+        // the centroids themselves aren't needed here, prepare() already packed them into tiles
+
+        const size_t numDimensions = points.numDimensions();
+
+        // size the block of points so it stays resident in L2 while every centroid tile streams past it
+        const size_t pointBlock = std::max<size_t>(POINT_TILE_MICRO,
+            (L2_POINT_BLOCK_BYTES / (numDimensions * sizeof(double))) / POINT_TILE_MICRO * POINT_TILE_MICRO);
+
+        std::vector<double> bestDistances(pointBlock);
+        std::vector<size_t> bestIndices(pointBlock);
+
+        for (size_t blockBegin = begin; blockBegin < end; blockBegin += pointBlock) {
+            const size_t blockEnd = std::min(blockBegin + pointBlock, end);
+            const size_t blockSize = blockEnd - blockBegin;
+
+            std::fill_n(bestDistances.begin(), blockSize, std::numeric_limits<double>::max());
+            std::fill_n(bestIndices.begin(), blockSize, 0);
+
+            for (size_t tile = 0; tile < m_NumCentroidTiles; ++tile) {
+                const double* packedTile = m_PackedCentroids.data() + tile * numDimensions * CENTROID_TILE;
+                const double* tileNorms = m_CentroidNorms.data() + tile * CENTROID_TILE;
+
+                for (size_t microBegin = blockBegin; microBegin < blockEnd; microBegin += POINT_TILE_MICRO) {
+                    const size_t microSize = std::min(POINT_TILE_MICRO, blockEnd - microBegin);
+
+                    // dots[r][c] = x_r . c_c for the micro tile of points against the whole centroid tile
+                    alignas(64) std::array<std::array<double, CENTROID_TILE>, POINT_TILE_MICRO> dots{};
+                    if (microSize == POINT_TILE_MICRO) {
+                        // the common case: a full micro tile, with every loop bound known at compile time so the
+                        // whole dots block can live in registers
+                        for (size_t dimension = 0; dimension < numDimensions; ++dimension) {
+                            const double* centroidColumn = packedTile + dimension * CENTROID_TILE;
+                            for (size_t r = 0; r < POINT_TILE_MICRO; ++r) {
+                                const double coordinate = points.row(microBegin + r)[dimension];
+                                for (size_t c = 0; c < CENTROID_TILE; ++c) {
+                                    dots[r][c] += coordinate * centroidColumn[c];
+                                }
+                            }
+                        }
+                    } else {
+                        for (size_t dimension = 0; dimension < numDimensions; ++dimension) {
+                            const double* centroidColumn = packedTile + dimension * CENTROID_TILE;
+                            for (size_t r = 0; r < microSize; ++r) {
+                                const double coordinate = points.row(microBegin + r)[dimension];
+                                for (size_t c = 0; c < CENTROID_TILE; ++c) {
+                                    dots[r][c] += coordinate * centroidColumn[c];
+                                }
+                            }
+                        }
+                    }
+
+                    // turn the dot products into squared distances, and keep the best one for each point
+                    for (size_t r = 0; r < microSize; ++r) {
+                        const size_t local = microBegin + r - blockBegin;
+                        const double pointNorm = m_PointNorms[microBegin + r];
+                        for (size_t c = 0; c < CENTROID_TILE; ++c) {
+                            const double distance = pointNorm - 2.0 * dots[r][c] + tileNorms[c];
+                            if (distance < bestDistances[local]) {
+                                bestDistances[local] = distance;
+                                bestIndices[local] = tile * CENTROID_TILE + c;
+                            }
+                        }
+                    }
+                }
+            }
+
+            // finally, accumulate the whole block
+            for (size_t local = 0; local < blockSize; ++local) {
+                sums.accumulate(bestIndices[local], points.row(blockBegin + local));
+            }
+        }
+    }
+
+} // kmeans
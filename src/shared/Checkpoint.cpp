@@ -0,0 +1,151 @@
+//
+// Created by Matthew Krueger on 11/8/25.
+//
+
+#include "Checkpoint.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "Instrumentation.hpp"
+
+namespace kmeans {
+
+    void writeCheckpoint(const std::filesystem::path &path, const Checkpoint &checkpoint) {
+        PROFILE_FUNCTION();
+
+        CheckpointFileHeader header{};
+        std::ranges::copy(CheckpointFileHeader::MAGIC, header.magic);
+        header.version = CheckpointFileHeader::CURRENT_VERSION;
+        header.byteOrderMark = CheckpointFileHeader::BYTE_ORDER_MARK;
+        header.nextIteration = checkpoint.nextIteration;
+        header.numCentroids = checkpoint.centroids.numCentroids();
+        header.numDimensions = checkpoint.centroids.numDimensions();
+        header.numRngStates = checkpoint.rngStates.size();
+
+        std::filesystem::path temporaryPath = path;
+        temporaryPath += ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                throw std::runtime_error("Cannot open " + temporaryPath.string() + " for writing");
+            }
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(checkpoint.centroids.buffer()), static_cast<std::streamsize>(checkpoint.centroids.bufferSize() * sizeof(double)));
+            const MiniBatchConvergence::State &convergence = checkpoint.miniBatchConvergence;
+            const uint64_t convergenceCounters[2] = {convergence.batchesWithoutImprovement, convergence.started ? 1u : 0u};
+            file.write(reinterpret_cast<const char*>(&convergence.averageInertia), sizeof(double));
+            file.write(reinterpret_cast<const char*>(&convergence.bestAverageInertia), sizeof(double));
+            file.write(reinterpret_cast<const char*>(convergenceCounters), sizeof(convergenceCounters));
+
+            for (const std::string &state : checkpoint.rngStates) {
+                const uint64_t length = state.size();
+                file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+                file.write(state.data(), static_cast<std::streamsize>(length));
+            }
+
+            file.flush();
+            if (!file) {
+                throw std::runtime_error("Failed writing " + temporaryPath.string());
+            }
+        }
+
+        // rename is atomic, so path is always either the old checkpoint or the new one, never half of each
+        std::filesystem::rename(temporaryPath, path);
+    }
+
+    Checkpoint readCheckpoint(const std::filesystem::path &path) {
+        PROFILE_FUNCTION();
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open checkpoint " + path.string());
+        }
+
+        CheckpointFileHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || std::memcmp(header.magic, CheckpointFileHeader::MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error(path.string() + " is not a checkpoint");
+        }
+        if (header.byteOrderMark != CheckpointFileHeader::BYTE_ORDER_MARK) {
+            throw std::runtime_error("Checkpoint was written on a machine with a different byte order");
+        }
+        if (header.version != CheckpointFileHeader::CURRENT_VERSION) {
+            throw std::runtime_error("Unsupported checkpoint version " + std::to_string(header.version));
+        }
+
+        Checkpoint checkpoint;
+        checkpoint.nextIteration = header.nextIteration;
+        checkpoint.centroids = CentroidMatrix(header.numCentroids, header.numDimensions);
+        file.read(reinterpret_cast<char*>(checkpoint.centroids.buffer()), static_cast<std::streamsize>(checkpoint.centroids.bufferSize() * sizeof(double)));
+
+        MiniBatchConvergence::State &convergence = checkpoint.miniBatchConvergence;
+        uint64_t convergenceCounters[2] = {0, 0};
+        file.read(reinterpret_cast<char*>(&convergence.averageInertia), sizeof(double));
+        file.read(reinterpret_cast<char*>(&convergence.bestAverageInertia), sizeof(double));
+        file.read(reinterpret_cast<char*>(convergenceCounters), sizeof(convergenceCounters));
+        convergence.batchesWithoutImprovement = convergenceCounters[0];
+        convergence.started = convergenceCounters[1] != 0;
+
+        checkpoint.rngStates.resize(header.numRngStates);
+        for (std::string &state : checkpoint.rngStates) {
+            uint64_t length = 0;
+            file.read(reinterpret_cast<char*>(&length), sizeof(length));
+            state.resize(length);
+            file.read(state.data(), static_cast<std::streamsize>(length));
+        }
+
+        if (!file) {
+            throw std::runtime_error("Checkpoint " + path.string() + " is truncated");
+        }
+        return checkpoint;
+    }
+
+    AsyncCheckpointWriter::AsyncCheckpointWriter(std::filesystem::path path) : m_Path(std::move(path)) {
+        m_Thread = std::thread(&AsyncCheckpointWriter::writerLoop, this);
+    }
+
+    AsyncCheckpointWriter::~AsyncCheckpointWriter() {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_Condition.notify_one();
+        m_Thread.join();
+    }
+
+    void AsyncCheckpointWriter::submit(Checkpoint checkpoint) {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Pending = std::move(checkpoint);
+        }
+        m_Condition.notify_one();
+    }
+
+    void AsyncCheckpointWriter::writerLoop() {
+        while (true) {
+            Checkpoint checkpoint;
+            {
+                std::unique_lock lock(m_Mutex);
+                m_Condition.wait(lock, [this] { return m_Pending.has_value() || m_Stopping; });
+                if (!m_Pending.has_value()) {
+                    return; // stopping, and nothing left to write
+                }
+                checkpoint = std::move(*m_Pending);
+                m_Pending.reset();
+            }
+
+            // the file I/O happens without the lock, so submit() never waits on the disk
+            try {
+                writeCheckpoint(m_Path, checkpoint);
+            } catch (const std::exception &e) {
+                std::cerr << "Checkpoint failed: " << e.what() << std::endl;
+            }
+        }
+    }
+
+} // kmeans
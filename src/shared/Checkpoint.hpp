@@ -0,0 +1,108 @@
+//
+// Created by Matthew Krueger on 11/8/25.
+//
+
+#ifndef KMEANS_MPI_CHECKPOINT_HPP
+#define KMEANS_MPI_CHECKPOINT_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MiniBatch.hpp"
+#include "PointMatrix.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief Everything a solver needs to carry on from where it was.
+     *
+     * The centroids are global, so a checkpoint doesn't depend on how many ranks wrote it. The per-point state of the
+     * accelerated engines (bounds, labels) is deliberately left out: it is as big as the dataset, it is tied to one
+     * partition, and the engines rebuild it in a single iteration anyway.
+     */
+    struct Checkpoint {
+        /// The iteration to run next
+        uint64_t nextIteration = 0;
+        /// The whole [coordinates][counts] block. The counts matter to mini-batch, where they are running totals.
+        CentroidMatrix centroids;
+        /// The mini-batch RNG of every rank, in rank order, as written by operator<<. Empty when there is no RNG to keep.
+        std::vector<std::string> rngStates;
+        /// Where the mini-batch stopping rule was. It's global, so there is just the one.
+        MiniBatchConvergence::State miniBatchConvergence;
+    };
+
+    /**
+     * @brief The fixed 64 byte header at the start of every checkpoint file.
+     *
+     * The layout of a file is:
+     *   [header][k * (d + 1) centroid doubles][mini-batch convergence: 2 doubles, 2 uint64]
+     *   [numRngStates times: uint64 length, then that many characters]
+     */
+    struct CheckpointFileHeader {
+        static constexpr char MAGIC[8] = {'K', 'M', 'E', 'A', 'N', 'S', 'C', 'K'};
+        static constexpr uint32_t CURRENT_VERSION = 1;
+        static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+        uint64_t nextIteration;
+        uint64_t numCentroids;
+        uint64_t numDimensions;
+        uint64_t numRngStates;
+        uint64_t reserved[2];
+    };
+    static_assert(sizeof(CheckpointFileHeader) == 64, "The checkpoint file header must be exactly 64 bytes");
+
+    /**
+     * @brief Writes a checkpoint. It goes to a temporary file first, which is then renamed over path, so a crash part way
+     * through never leaves a torn checkpoint behind, only the previous one.
+     * @throws std::runtime_error if the file can't be written
+     */
+    void writeCheckpoint(const std::filesystem::path& path, const Checkpoint& checkpoint);
+
+    /**
+     * @brief Reads a checkpoint written by writeCheckpoint().
+     * @throws std::runtime_error if the file can't be read, or isn't a valid checkpoint
+     */
+    Checkpoint readCheckpoint(const std::filesystem::path& path);
+
+    /**
+     * @brief Writes checkpoints on a background thread, so an iteration only pays for copying the centroids.
+     *
+     * If a checkpoint is handed over while the last one is still being written, it replaces any that is still waiting,
+     * since only the newest one is worth having. Whatever is waiting is written before the writer is destroyed.
+     * A failed write is reported on std::cerr, and the run carries on.
+     */
+    class AsyncCheckpointWriter {
+    public:
+        explicit AsyncCheckpointWriter(std::filesystem::path path);
+        AsyncCheckpointWriter(const AsyncCheckpointWriter&) = delete;
+        AsyncCheckpointWriter& operator=(const AsyncCheckpointWriter&) = delete;
+        ~AsyncCheckpointWriter();
+
+        /**
+         * @brief Queues a checkpoint to be written, and returns straight away.
+         */
+        void submit(Checkpoint checkpoint);
+
+    private:
+        void writerLoop();
+
+        std::filesystem::path m_Path;
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::optional<Checkpoint> m_Pending;
+        bool m_Stopping = false;
+        std::thread m_Thread;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_CHECKPOINT_HPP
@@ -5,45 +5,43 @@
 #include "DataSet.hpp"
 
 #include <algorithm>
+#include <cstring>
+#include <stdexcept>
 #include <ranges>
-#include <boost/random/normal_distribution.hpp>
 #include <memory>
 
+#include "DataSetFile.hpp"
 #include "Instrumentation.hpp"
+#include "Philox.hpp"
 
 namespace kmeans {
 
-    // Choose treachery and evil auto return,
-    // It's more FUN!
-    // Uncle Iroh in The Ember Island Players (probably)
-    auto DataSet::generateCluster(const Point &clusterCenter, size_t numberPoints, double clusterSpread,
-                                  std::shared_ptr<std::mt19937> rng) {
-        PROFILE_FUNCTION();
+    DataSet::DataSet(const Config& config) : DataSet(config, 0, config.numTotalSamples) {}
 
-        // reserve the vector
-        size_t clusterNumberDimensions = clusterCenter.getData().size();
-        auto distributions = std::make_shared<std::vector<boost::normal_distribution<double>>>();
-        distributions->reserve(clusterNumberDimensions);
+    DataSet::DataSet(const std::filesystem::path &path) {
+        PROFILE_FUNCTION();
 
-        // use std::ranges::transform to populate distributions with gauntness distributions *BASED ON* the cluster center
-        // back inserter is used to make sure the distributions iterator stays valid
-        std::ranges::transform(clusterCenter,
-                               std::back_inserter(*distributions),
-                               [clusterSpread](double dimension) {
-                                   PROFILE_FUNCTION();
-                                   return boost::normal_distribution<double>(dimension, clusterSpread);
-                               }
-        );
+        auto file = std::make_shared<MappedFile>(path);
+        if (file->size() < sizeof(DataSetFileHeader)) {
+            throw std::runtime_error(path.string() + " is too small to be a dataset file");
+        }
 
-        // we will now generate points with each index in the vector using its own corresponding boost distribution.
-        auto generatedPointsView = std::ranges::views::iota((size_t)0, numberPoints)
-                           | std::ranges::views::transform([distributions, rng](int) { return generateSinglePoint(distributions, rng); });
+        DataSetFileHeader header{};
+        std::memcpy(&header, file->data(), sizeof(header));
+        header.validate(file->size());
 
-        return generatedPointsView;
+        // the points and weights are views straight into the mapping, and both keep it alive
+        m_Points = PointMatrix::view(reinterpret_cast<double*>(file->data() + header.dataOffset), header.numPoints, header.numDimensions, file);
+        if (header.hasWeights()) {
+            m_Weights = PointMatrix::view(reinterpret_cast<double*>(file->data() + header.weightsOffset), header.numPoints, 1, file);
+        }
+    }
 
+    void DataSet::writeToFile(const std::filesystem::path &path) const {
+        writeDataSetFile(path, m_Points, getWeights());
     }
 
-    DataSet::DataSet(const Config& config) {
+    DataSet::DataSet(const Config& config, const size_t firstPoint, const size_t numPoints) {
         PROFILE_FUNCTION();
 
         // First, we should make sure the config parameter is valid
@@ -55,10 +53,11 @@ namespace kmeans {
             throw std::invalid_argument("Dimension Distributions does not contain expected number of dimensions");
         }
 
-        // reserve the right number of samples
-        m_Points.reserve(config.numTotalSamples);
+        if (firstPoint + numPoints > config.numTotalSamples) {
+            throw std::invalid_argument("Cannot generate points past the end of the dataset");
+        }
 
-        // create our random
+        // create our random. This one only picks the known good centroids, so every shard makes the same ones
         auto rng = std::make_shared<std::mt19937>(config.seed);
 
         // scope the generation of our known good centroids
@@ -68,9 +67,6 @@ namespace kmeans {
             // create our distributions (we are using linear distributions for now
             // This is on a PER DIMENSION BASIS.
             // ESSENTIALLY, WE NEED TO HAVE A VECTOR OF DISTRIBUTIONS SO THAT WE CAN THEN MAKE A VECTOR OF POINTS, RANDOMIZED WITH PER DIMENSION RANDOM NUMBERS
-            std::vector<boost::normal_distribution<double>> distributions;
-            distributions.reserve(config.numDimensions);
-
             // and actually create them
             auto clusterCentroidGeneratorDistributionView = std::ranges::views::iota(static_cast<size_t>(0), config.numDimensions)
                 | std::ranges::views::transform([&config](size_t dimension) {
@@ -101,60 +97,36 @@ namespace kmeans {
 
         // now that we have known good centroids FROM WHICH we can generate our clusters, we can actually generate the cluster
         // First we need to get a list of the NUMBER of samples per centroid
-        // In other words, the "stride" of the data
-        size_t samplesPerCentroid = config.numTotalSamples / config.numTrueClusters;
-        size_t samplesLeftover = config.numTotalSamples % config.numTrueClusters;
-        // Create a view for the number of samples per cluster, accounting for leftovers.
-        auto samplesPerClusterView = std::ranges::views::iota(static_cast<size_t>(0), config.numTrueClusters)
-            | std::ranges::views::transform([samplesPerCentroid, samplesLeftover](size_t clusterIdx) {
-                PROFILE_FUNCTION();
-                // Distribute leftovers to the first few clusters.
-                return samplesPerCentroid + (clusterIdx < samplesLeftover ? 1 : 0);
-            });
-
-        // Now that we know how many per centroid, we can call DataSet::generateCluster for each centroid, with the number of samples, the RNG, the cluster center as the centroid.
-        // Generate clusters using a ranges pipeline.
-
-        auto knownGoodCentroidsWithCountsView = std::ranges::views::zip(m_KnownGoodCentroids.value(), samplesPerClusterView);
-
-        auto clustersView = knownGoodCentroidsWithCountsView
-            | std::ranges::views::transform([rng, &config](const auto& tuple) {
-                PROFILE_FUNCTION();
-
-                const auto& centroid = std::get<0>(tuple); // get the centroid
-                const size_t numSamples = std::get<1>(tuple); // and the number of samples
-                return generateCluster(
-                    centroid,
-                    numSamples,
-                    config.clusterSpread,
-                    rng
-                );
-            })
-            | std::ranges::views::join; // Flatten the clusters into a single range of points.
-
-        // Collect the generated points into m_Points
+        // In other words, the "stride" of the data. The first samplesLeftover clusters get one extra point, and the
+        // clusters are laid out back to back, so the cluster of any global index can be worked out directly
+        const size_t samplesPerCentroid = config.numTotalSamples / config.numTrueClusters;
+        const size_t samplesLeftover = config.numTotalSamples % config.numTrueClusters;
+        const size_t largeClusterPoints = samplesLeftover * (samplesPerCentroid + 1);
+        const auto clusterOf = [=](const size_t pointIndex) {
+            return (pointIndex < largeClusterPoints)
+                ? pointIndex / (samplesPerCentroid + 1)
+                : samplesLeftover + (pointIndex - largeClusterPoints) / samplesPerCentroid;
+        };
+
+        // now generate our rows straight into the matrix. Each point is a pure function of (seed, global index), with
+        // the dimensions drawn two at a time from Box-Muller, so it doesn't matter who generates it or in what order.
+        m_Points = PointMatrix(numPoints, config.numDimensions);
         {
-            PROFILE_SCOPE("Collect generated points into m_Points");
-            m_Points.reserve(config.numTotalSamples);
-            std::ranges::move(clustersView, std::back_inserter(m_Points));
+            PROFILE_SCOPE("Generate points");
+            for (size_t row = 0; row < numPoints; ++row) {
+                const size_t pointIndex = firstPoint + row;
+                const std::vector<double> &center = m_KnownGoodCentroids.value()[clusterOf(pointIndex)].getData();
+                double* point = m_Points.row(row);
+
+                for (size_t dimension = 0; dimension < config.numDimensions; dimension += 2) {
+                    const auto [first, second] = Philox4x32::standardNormalPair(config.seed, pointIndex, dimension / 2);
+                    point[dimension] = center[dimension] + config.clusterSpread * first;
+                    if (dimension + 1 < config.numDimensions) {
+                        point[dimension + 1] = center[dimension + 1] + config.clusterSpread * second;
+                    }
+                }
+            }
         }
     }
 
-    Point DataSet::generateSinglePoint(const std::shared_ptr<std::vector<boost::normal_distribution<double>>>& distributions, std::shared_ptr<std::mt19937> rng) {
-        PROFILE_FUNCTION();
-
-        // back inserter doesn't play nice so we will make a vector then move it to the
-        std::vector<double> dimensionsForPoint;
-        dimensionsForPoint.reserve(distributions->size()); // Pre-reserve for dimensions.
-
-        std::ranges::transform(*distributions,
-                               std::back_inserter(dimensionsForPoint),
-                               [&](auto& dist){ return dist(*rng); }); // Sample each dimension
-
-        return Point(std::move(dimensionsForPoint)); // Assuming Point can be constructed from std::vector<double>.
-        // If Point *is* std::vector<double>, just 'return dimensionsForPoint;'
-
-    }
-
-
-} // kmeans
\ No newline at end of file
+} // kmeans
@@ -4,15 +4,17 @@
 
 #ifndef KMEANS_MPI_DATASET_HPP
 #define KMEANS_MPI_DATASET_HPP
+#include <filesystem>
+#include <span>
 #include <vector>
 #include <random>
 #include <optional>
 #include <algorithm>
-#include <boost/random/normal_distribution.hpp>
 
 
 #include "Instrumentation.hpp"
 #include "Point.hpp"
+#include "PointMatrix.hpp"
 
 namespace kmeans {
     class DataSet {
@@ -92,43 +94,78 @@ namespace kmeans {
         };
 
         DataSet() = default;
-        explicit DataSet(std::vector<Point> points) : m_Points(std::move(points)) {}
+        explicit DataSet(const std::vector<Point>& points) : m_Points(PointMatrix::fromPoints(points)) {}
+        explicit DataSet(PointMatrix points) : m_Points(std::move(points)) {}
+        /**
+         * @brief Wraps points that already come with their weights.
+         * @param points The points
+         * @param weights n x 1, one weight per point, or empty for none
+         */
+        DataSet(PointMatrix points, PointMatrix weights) : m_Points(std::move(points)), m_Weights(std::move(weights)) {}
         explicit DataSet(const Config& config);
 
+        /**
+         * @brief Generates just the rows [firstPoint, firstPoint + numPoints) of the dataset that config describes.
+         *
+         * Every point is generated from its global index with a counter-based RNG, so a shard is bit-identical to the
+         * same rows of the full dataset, and the shards of any number of ranks line up into exactly that dataset.
+         * The known good centroids are cheap, so every shard generates all of them.
+         * @param config The description of the WHOLE dataset
+         * @param firstPoint The global index of the first row to generate
+         * @param numPoints How many rows to generate
+         */
+        DataSet(const Config& config, size_t firstPoint, size_t numPoints);
+
+        /**
+         * @brief Loads a dataset file (see DataSetFile.hpp) by memory mapping it. Nothing is copied or parsed.
+         *
+         * The points are a PointMatrix view straight into the mapping, which stays mapped for as long as this dataset,
+         * or any copy of its points, is alive. There are no known good centroids for a file.
+         * @param path The file to load
+         * @throws std::runtime_error if the file can't be mapped, or isn't a valid dataset file
+         */
+        explicit DataSet(const std::filesystem::path& path);
+
+        /**
+         * @brief Writes the dataset, and its weights if it has any, as a dataset file that DataSet(path) can load.
+         * @param path Where to write. Overwritten if it exists.
+         */
+        void writeToFile(const std::filesystem::path& path) const;
+
         inline size_t size() const { return m_Points.size(); }
         inline bool empty() const { return m_Points.empty(); }
-        inline const Point& operator[](const size_t index) const { return m_Points[index]; }
+        inline size_t numDimensions() const { return m_Points.numDimensions(); }
+        inline PointView operator[](const size_t index) const { return m_Points[index]; }
         inline std::optional<std::vector<Point>>& getKnownGoodCentroids() { return m_KnownGoodCentroids; }
 
         inline Point::FlattenedPoints flattenDataset() { return Point::flattenPoints(m_Points); };
         inline static std::vector<Point> unflattenDataset(const Point::FlattenedPoints &flattenedPoints) { return Point::unflattenPoints(flattenedPoints); };
 
-        using iterator = std::vector<Point>::iterator;
-        using const_iterator = std::vector<Point>::const_iterator;
-
-        inline iterator begin() { return m_Points.begin(); }
-        [[nodiscard]] inline const_iterator begin() const { return m_Points.begin(); }
-        inline iterator end() { return m_Points.end(); }
-        [[nodiscard]] inline const_iterator end() const { return m_Points.end(); }
+        /**
+         * @brief Gets the contiguous row-major storage backing the dataset.
+         * @return A const reference to the point matrix
+         */
+        inline const PointMatrix& getPoints() const { return m_Points; }
 
-        inline const std::vector<Point>& getPoints() const { return m_Points; }
+        /**
+         * @brief Gets the per-point weights, if the dataset was mapped from a file with a weights column.
+         *
+         * None of the solvers cluster by weight yet, so the weights only go as far as writeToFile(). They aren't handed
+         * to the solvers, or read by readDataSetFileSlice().
+         * @return One weight per point, or an empty span if there are none
+         */
+        inline std::span<const double> getWeights() const { return {m_Weights.data(), m_Weights.numPoints()}; }
+        inline bool hasWeights() const { return !m_Weights.empty(); }
 
     private:
-        inline void reserve(size_t size) { m_Points.reserve(size); }
-        inline void emplace_back(const Point &toEmplace) { m_Points.emplace_back(toEmplace); }
-
-        static auto generateCluster(const Point &clusterCenter, size_t numberPoints, double clusterSpread,
-                                    std::shared_ptr<std::mt19937> rng);
-
-        std::vector<Point> m_Points;
+        PointMatrix m_Points;
+        /// n x 1, and empty unless the dataset came from a file with weights
+        PointMatrix m_Weights;
 
         // for our 0, we have the known good centroids. We'll just extract and store this so we can use it later, or we might not
         // even use it at all. It's just here since we'll already have it.
         std::optional<std::vector<Point>> m_KnownGoodCentroids = std::nullopt;
 
-        static Point generateSinglePoint(const std::shared_ptr<std::vector<boost::normal_distribution<double>>>& distributions, std::shared_ptr<std::mt19937> rng);
-
-
     };
 } // kmeans
 
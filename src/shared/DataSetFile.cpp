@@ -0,0 +1,136 @@
+//
+// Created by Matthew Krueger on 11/4/25.
+//
+
+#include "DataSetFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Instrumentation.hpp"
+
+namespace kmeans {
+
+    namespace {
+        uint64_t alignUp(const uint64_t offset) {
+            return (offset + DATASET_FILE_ALIGNMENT - 1) / DATASET_FILE_ALIGNMENT * DATASET_FILE_ALIGNMENT;
+        }
+    }
+
+    void DataSetFileHeader::validate(const uint64_t fileSize) const {
+        if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Not a dataset file");
+        }
+        if (byteOrderMark != BYTE_ORDER_MARK) {
+            throw std::runtime_error("Dataset file was written on a machine with a different byte order");
+        }
+        if (version != CURRENT_VERSION) {
+            throw std::runtime_error("Unsupported dataset file version " + std::to_string(version));
+        }
+        if (type != DataSetFileType::Float64) {
+            throw std::runtime_error("Unsupported dataset file element type " + std::to_string(static_cast<uint32_t>(type)));
+        }
+        if (dataOffset % DATASET_FILE_ALIGNMENT != 0 || (hasWeights() && weightsOffset % DATASET_FILE_ALIGNMENT != 0)) {
+            throw std::runtime_error("Dataset file sections are not aligned");
+        }
+
+        const uint64_t dataEnd = dataOffset + numPoints * numDimensions * sizeof(double);
+        const uint64_t end = hasWeights() ? weightsOffset + numPoints * sizeof(double) : dataEnd;
+        if (dataOffset < sizeof(DataSetFileHeader) || (hasWeights() && weightsOffset < dataEnd) || end > fileSize) {
+            throw std::runtime_error("Dataset file is truncated or its offsets are inconsistent");
+        }
+    }
+
+    MappedFile::MappedFile(const std::filesystem::path &path) {
+        PROFILE_FUNCTION();
+
+        const int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw std::runtime_error("Cannot open " + path.string() + ": " + std::strerror(errno));
+        }
+
+        struct stat status{};
+        if (::fstat(descriptor, &status) != 0) {
+            const int error = errno;
+            ::close(descriptor);
+            throw std::runtime_error("Cannot stat " + path.string() + ": " + std::strerror(error));
+        }
+        m_Size = static_cast<size_t>(status.st_size);
+
+        if (m_Size > 0) {
+            // private and writable, so a stray write only ever touches our own copy of that page, never the file
+            void* mapping = ::mmap(nullptr, m_Size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+            if (mapping == MAP_FAILED) {
+                const int error = errno;
+                ::close(descriptor);
+                throw std::runtime_error("Cannot map " + path.string() + ": " + std::strerror(error));
+            }
+            m_Data = static_cast<std::byte*>(mapping);
+
+            // we are going to stream through it front to back, every iteration
+            ::madvise(mapping, m_Size, MADV_SEQUENTIAL);
+        }
+
+        // the mapping holds its own reference to the file
+        ::close(descriptor);
+    }
+
+    MappedFile::~MappedFile() {
+        if (m_Data != nullptr) {
+            ::munmap(m_Data, m_Size);
+        }
+    }
+
+    void writeDataSetFile(const std::filesystem::path &path, const PointMatrix &points, const std::span<const double> weights) {
+        PROFILE_FUNCTION();
+
+        if (!weights.empty() && weights.size() != points.numPoints()) {
+            throw std::invalid_argument("A dataset file needs exactly one weight per point");
+        }
+
+        DataSetFileHeader header{};
+        std::ranges::copy(DataSetFileHeader::MAGIC, header.magic);
+        header.version = DataSetFileHeader::CURRENT_VERSION;
+        header.byteOrderMark = DataSetFileHeader::BYTE_ORDER_MARK;
+        header.type = DataSetFileType::Float64;
+        header.numPoints = points.numPoints();
+        header.numDimensions = points.numDimensions();
+        header.flags = weights.empty() ? 0 : DATASET_FILE_HAS_WEIGHTS;
+        header.dataOffset = alignUp(sizeof(DataSetFileHeader));
+        const uint64_t dataBytes = header.numPoints * header.numDimensions * sizeof(double);
+        header.weightsOffset = weights.empty() ? 0 : alignUp(header.dataOffset + dataBytes);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open " + path.string() + " for writing");
+        }
+
+        constexpr std::array<char, DATASET_FILE_ALIGNMENT> padding{};
+        const auto padTo = [&](const uint64_t offset) {
+            const auto position = static_cast<uint64_t>(file.tellp());
+            file.write(padding.data(), static_cast<std::streamsize>(offset - position));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        padTo(header.dataOffset);
+        file.write(reinterpret_cast<const char*>(points.data()), static_cast<std::streamsize>(dataBytes));
+        if (!weights.empty()) {
+            padTo(header.weightsOffset);
+            file.write(reinterpret_cast<const char*>(weights.data()), static_cast<std::streamsize>(weights.size_bytes()));
+        }
+
+        if (!file) {
+            throw std::runtime_error("Failed writing " + path.string());
+        }
+    }
+
+} // kmeans
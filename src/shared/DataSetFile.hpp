@@ -0,0 +1,104 @@
+//
+// Created by Matthew Krueger on 11/4/25.
+//
+
+#ifndef KMEANS_MPI_DATASETFILE_HPP
+#define KMEANS_MPI_DATASETFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "PointMatrix.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief The element types a dataset file can hold. Only doubles for now, but the field is there so the format
+     * doesn't have to change to add more.
+     */
+    enum class DataSetFileType : uint32_t {
+        Float64 = 1
+    };
+
+    /// Set in DataSetFileHeader::flags when the file has a weights column after the points
+    inline constexpr uint64_t DATASET_FILE_HAS_WEIGHTS = 1;
+    /// The points and the weights each start on a multiple of this, so a mapped file can be used by the kernels as-is
+    inline constexpr size_t DATASET_FILE_ALIGNMENT = 64;
+
+    /**
+     * @brief The fixed 64 byte header at the start of every dataset file.
+     *
+     * The layout of a file is:
+     *   [header][padding to 64][n * d row-major points][padding to 64][n weights, if DATASET_FILE_HAS_WEIGHTS]
+     *
+     * Everything is in the byte order of the machine that wrote it. The byte order mark lets a reader on the other kind
+     * of machine notice, rather than silently reading garbage.
+     */
+    struct DataSetFileHeader {
+        static constexpr char MAGIC[8] = {'K', 'M', 'E', 'A', 'N', 'S', 'D', 'S'};
+        static constexpr uint32_t CURRENT_VERSION = 1;
+        static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+        DataSetFileType type;
+        uint32_t reserved;
+        uint64_t numPoints;
+        uint64_t numDimensions;
+        uint64_t flags;
+        /// The byte offset of the first point
+        uint64_t dataOffset;
+        /// The byte offset of the first weight, or 0 if there are none
+        uint64_t weightsOffset;
+
+        [[nodiscard]] inline bool hasWeights() const { return (flags & DATASET_FILE_HAS_WEIGHTS) != 0; }
+
+        /**
+         * @brief Makes sure this is a dataset file we can read, and that it fits in a file of the given size.
+         * @throws std::runtime_error describing the first problem found
+         */
+        void validate(uint64_t fileSize) const;
+    };
+    static_assert(sizeof(DataSetFileHeader) == 64, "The dataset file header must be exactly 64 bytes");
+
+    /**
+     * @brief A whole file, memory mapped read-only and copy-on-write, and unmapped when destroyed.
+     *
+     * Pages are only read from disk when they are first touched, so mapping a 10 GB file is instant, and two processes
+     * on one node mapping the same file share the page cache rather than each holding a copy.
+     */
+    class MappedFile {
+    public:
+        /**
+         * @brief Maps a file.
+         * @throws std::runtime_error if the file can't be opened or mapped
+         */
+        explicit MappedFile(const std::filesystem::path& path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        [[nodiscard]] inline std::byte* data() const { return m_Data; }
+        [[nodiscard]] inline size_t size() const { return m_Size; }
+
+    private:
+        std::byte* m_Data = nullptr;
+        size_t m_Size = 0;
+    };
+
+    /**
+     * @brief Writes points, and optionally their weights, as a dataset file.
+     * @param path Where to write. Overwritten if it exists.
+     * @param points The points
+     * @param weights One weight per point, or empty for no weights column
+     * @throws std::invalid_argument if the weights don't match the points
+     * @throws std::runtime_error if the file can't be written
+     */
+    void writeDataSetFile(const std::filesystem::path& path, const PointMatrix& points, std::span<const double> weights = {});
+
+} // kmeans
+
+#endif //KMEANS_MPI_DATASETFILE_HPP
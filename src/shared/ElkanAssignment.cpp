@@ -0,0 +1,152 @@
+//
+// Created by Matthew Krueger on 10/27/25.
+//
+
+#include "ElkanAssignment.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "AssignmentKernel.hpp"
+#include "Instrumentation.hpp"
+
+namespace kmeans {
+
+    void ElkanAssignmentEngine::prepare(const PointMatrix &points, const CentroidMatrix &centroids) {
+        PROFILE_FUNCTION();
+
+        const size_t numCentroids = centroids.numCentroids();
+        const size_t numDimensions = centroids.numDimensions();
+
+        // if we have never seen these points (or these centroids), the bounds mean nothing, and we start over
+        if (m_PointsSource != points.data() || m_NumPoints != points.numPoints() || m_NumCentroids != numCentroids) {
+            m_NumPoints = points.numPoints();
+            m_NumCentroids = numCentroids;
+            m_PointsSource = points.data();
+            m_Labels.assign(m_NumPoints, 0);
+            m_UpperBounds.assign(m_NumPoints, 0.0);
+            m_LowerBounds.assign(m_NumPoints * m_NumCentroids, 0.0);
+            m_Drift.assign(m_NumCentroids, 0.0);
+            m_Initializing = true;
+        } else {
+            // otherwise, measure how far each centroid moved. The bounds themselves are shifted lazily in assign(),
+            // one row at a time, so that work is split up the same way the rows are
+            m_Initializing = false;
+            for (size_t centroid = 0; centroid < numCentroids; ++centroid) {
+                m_Drift[centroid] = std::sqrt(kernel::squaredEuclideanDistance(
+                    m_LastCentroids.data() + centroid * numDimensions, centroids.row(centroid), numDimensions));
+            }
+        }
+
+        m_LastCentroids.assign(centroids.coordinates(), centroids.coordinates() + numCentroids * numDimensions);
+
+        // the centroid-to-centroid distances, and half the distance to each centroid's nearest neighbour
+        m_CentroidDistances.assign(numCentroids * numCentroids, 0.0);
+        m_HalfNearestCentroidDistance.assign(numCentroids, std::numeric_limits<double>::max());
+        for (size_t i = 0; i < numCentroids; ++i) {
+            for (size_t j = i + 1; j < numCentroids; ++j) {
+                const double distance = std::sqrt(kernel::squaredEuclideanDistance(centroids.row(i), centroids.row(j), numDimensions));
+                m_CentroidDistances[i * numCentroids + j] = distance;
+                m_CentroidDistances[j * numCentroids + i] = distance;
+                m_HalfNearestCentroidDistance[i] = std::min(m_HalfNearestCentroidDistance[i], 0.5 * distance);
+                m_HalfNearestCentroidDistance[j] = std::min(m_HalfNearestCentroidDistance[j], 0.5 * distance);
+            }
+        }
+    }
+
+    void ElkanAssignmentEngine::initializeRows(const PointMatrix &points, const CentroidMatrix &centroids, const size_t begin, const size_t end, CentroidMatrix &sums) {
+        // the first time through, there is nothing to prune with, so every distance is evaluated, and every one of them
+        // becomes an exact lower bound
+        const size_t numDimensions = points.numDimensions();
+        for (size_t index = begin; index < end; ++index) {
+            const double* point = points.row(index);
+            double* lower = m_LowerBounds.data() + index * m_NumCentroids;
+
+            uint32_t label = 0;
+            double best = std::numeric_limits<double>::max();
+            for (size_t centroid = 0; centroid < m_NumCentroids; ++centroid) {
+                const double distance = std::sqrt(kernel::squaredEuclideanDistance(point, centroids.row(centroid), numDimensions));
+                lower[centroid] = distance;
+                if (distance < best) {
+                    best = distance;
+                    label = static_cast<uint32_t>(centroid);
+                }
+            }
+
+            m_Labels[index] = label;
+            m_UpperBounds[index] = best;
+            sums.accumulate(label, point);
+        }
+
+        m_DistanceEvaluations.fetch_add((end - begin) * m_NumCentroids, std::memory_order_relaxed);
+    }
+
+    void ElkanAssignmentEngine::assign(const PointMatrix &points, const CentroidMatrix &centroids, const size_t begin, const size_t end, CentroidMatrix &sums) {
+        PROFILE_FUNCTION();
+
+        if (m_Initializing) {
+            initializeRows(points, centroids, begin, end, sums);
+            return;
+        }
+
+        const size_t numDimensions = points.numDimensions();
+        uint64_t evaluations = 0;
+
+        for (size_t index = begin; index < end; ++index) {
+            const double* point = points.row(index);
+            double* lower = m_LowerBounds.data() + index * m_NumCentroids;
+            uint32_t label = m_Labels[index];
+
+            // shift the bounds by how far the centroids moved. The lower bounds can only shrink, the upper can only grow.
+            for (size_t centroid = 0; centroid < m_NumCentroids; ++centroid) {
+                lower[centroid] = std::max(0.0, lower[centroid] - m_Drift[centroid]);
+            }
+            double upper = m_UpperBounds[index] + m_Drift[label];
+
+            // if the point is closer to its centroid than half the gap to any other centroid, nothing can beat it
+            if (upper <= m_HalfNearestCentroidDistance[label]) {
+                m_UpperBounds[index] = upper;
+                sums.accumulate(label, point);
+                continue;
+            }
+
+            bool upperIsStale = true;
+            for (size_t centroid = 0; centroid < m_NumCentroids; ++centroid) {
+                if (centroid == label) {
+                    continue;
+                }
+                const double halfGap = 0.5 * m_CentroidDistances[label * m_NumCentroids + centroid];
+                if (upper <= lower[centroid] || upper <= halfGap) {
+                    continue;
+                }
+
+                // tighten the upper bound to the real distance once, and re-check before paying for this centroid
+                if (upperIsStale) {
+                    upper = std::sqrt(kernel::squaredEuclideanDistance(point, centroids.row(label), numDimensions));
+                    lower[label] = upper;
+                    upperIsStale = false;
+                    ++evaluations;
+                    if (upper <= lower[centroid] || upper <= halfGap) {
+                        continue;
+                    }
+                }
+
+                const double distance = std::sqrt(kernel::squaredEuclideanDistance(point, centroids.row(centroid), numDimensions));
+                lower[centroid] = distance;
+                ++evaluations;
+                if (distance < upper) {
+                    upper = distance;
+                    label = static_cast<uint32_t>(centroid);
+                }
+            }
+
+            m_Labels[index] = label;
+            m_UpperBounds[index] = upper;
+            sums.accumulate(label, point);
+        }
+
+        m_DistanceEvaluations.fetch_add(evaluations, std::memory_order_relaxed);
+    }
+
+} // kmeans
@@ -0,0 +1,71 @@
+//
+// Created by Matthew Krueger on 10/27/25.
+//
+
+#ifndef KMEANS_MPI_ELKANASSIGNMENT_HPP
+#define KMEANS_MPI_ELKANASSIGNMENT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AssignmentEngine.hpp"
+#include "PointMatrix.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief An exact assignment engine that uses the triangle inequality to skip distance evaluations (Elkan, 2003).
+     *
+     * For every point it keeps an upper bound on the distance to its assigned centroid, and a lower bound on the
+     * distance to EVERY centroid, plus the label itself. Every iteration it also computes the full centroid-to-centroid
+     * distance matrix. A point's distance to centroid j only has to be evaluated when its upper bound is above both its
+     * lower bound for j and half the distance between its current centroid and j. Once the centroids stop moving much,
+     * that is almost never, so the late iterations cost roughly O(n * k) comparisons rather than O(n * k * d) arithmetic.
+     *
+     * The price is memory: the lower bounds are n * k doubles. For large k, prefer a Hamerly or Yinyang style engine.
+     *
+     * The labels it produces are the same as Lloyd's, up to ties between equidistant centroids.
+     */
+    class ElkanAssignmentEngine final : public AssignmentEngine {
+    public:
+        void prepare(const PointMatrix& points, const CentroidMatrix& centroids) override;
+        void assign(const PointMatrix& points, const CentroidMatrix& centroids, size_t begin, size_t end, CentroidMatrix& sums) override;
+
+        /**
+         * @brief Gets the number of point to centroid distances actually evaluated since the engine was created.
+         *
+         * Plain Lloyd would evaluate n * k per iteration, so this is a direct measure of how much work the bounds saved.
+         */
+        [[nodiscard]] inline uint64_t getDistanceEvaluations() const { return m_DistanceEvaluations.load(std::memory_order_relaxed); }
+
+    private:
+        void initializeRows(const PointMatrix& points, const CentroidMatrix& centroids, size_t begin, size_t end, CentroidMatrix& sums);
+
+        size_t m_NumPoints = 0;
+        size_t m_NumCentroids = 0;
+        const double* m_PointsSource = nullptr;
+        /// Whether this iteration has to build the bounds from scratch (first iteration, or new points)
+        bool m_Initializing = true;
+
+        std::vector<uint32_t> m_Labels;
+        std::vector<double> m_UpperBounds;
+        /// n * k lower bounds, row-major by point
+        std::vector<double> m_LowerBounds;
+
+        /// The centroids the bounds are currently relative to, so we can measure how far each one moved
+        AlignedDoubleVector m_LastCentroids;
+        /// How far each centroid moved since the previous iteration
+        std::vector<double> m_Drift;
+        /// k * k centroid-to-centroid distances
+        std::vector<double> m_CentroidDistances;
+        /// Half the distance from each centroid to its nearest other centroid
+        std::vector<double> m_HalfNearestCentroidDistance;
+
+        std::atomic<uint64_t> m_DistanceEvaluations = 0;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_ELKANASSIGNMENT_HPP
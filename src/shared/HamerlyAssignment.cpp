@@ -0,0 +1,136 @@
+//
+// Created by Matthew Krueger on 10/28/25.
+//
+
+#include "HamerlyAssignment.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "AssignmentKernel.hpp"
+#include "Instrumentation.hpp"
+
+namespace kmeans {
+
+    void HamerlyAssignmentEngine::prepare(const PointMatrix &points, const CentroidMatrix &centroids) {
+        PROFILE_FUNCTION();
+
+        const size_t numCentroids = centroids.numCentroids();
+        const size_t numDimensions = centroids.numDimensions();
+
+        // if we have never seen these points (or these centroids), the bounds mean nothing, and we start over
+        if (m_PointsSource != points.data() || m_NumPoints != points.numPoints() || m_NumCentroids != numCentroids) {
+            m_NumPoints = points.numPoints();
+            m_NumCentroids = numCentroids;
+            m_PointsSource = points.data();
+            m_Labels.assign(m_NumPoints, 0);
+            m_UpperBounds.assign(m_NumPoints, 0.0);
+            m_LowerBounds.assign(m_NumPoints, 0.0);
+            m_Drift.assign(m_NumCentroids, 0.0);
+            m_Initializing = true;
+        } else {
+            // measure how far each centroid moved, and keep the two largest moves. A point's lower bound is on the
+            // distance to ANY other centroid, so it has to shrink by the largest move among the centroids it isn't in.
+            m_Initializing = false;
+            m_MaxDrift = 0.0;
+            m_SecondMaxDrift = 0.0;
+            m_MaxDriftCentroid = 0;
+            for (size_t centroid = 0; centroid < numCentroids; ++centroid) {
+                const double drift = std::sqrt(kernel::squaredEuclideanDistance(
+                    m_LastCentroids.data() + centroid * numDimensions, centroids.row(centroid), numDimensions));
+                m_Drift[centroid] = drift;
+                if (drift > m_MaxDrift) {
+                    m_SecondMaxDrift = m_MaxDrift;
+                    m_MaxDrift = drift;
+                    m_MaxDriftCentroid = centroid;
+                } else if (drift > m_SecondMaxDrift) {
+                    m_SecondMaxDrift = drift;
+                }
+            }
+        }
+
+        m_LastCentroids.assign(centroids.coordinates(), centroids.coordinates() + numCentroids * numDimensions);
+
+        // half the distance from each centroid to its nearest neighbour
+        m_HalfNearestCentroidDistance.assign(numCentroids, std::numeric_limits<double>::max());
+        for (size_t i = 0; i < numCentroids; ++i) {
+            for (size_t j = i + 1; j < numCentroids; ++j) {
+                const double halfDistance = 0.5 * std::sqrt(kernel::squaredEuclideanDistance(centroids.row(i), centroids.row(j), numDimensions));
+                m_HalfNearestCentroidDistance[i] = std::min(m_HalfNearestCentroidDistance[i], halfDistance);
+                m_HalfNearestCentroidDistance[j] = std::min(m_HalfNearestCentroidDistance[j], halfDistance);
+            }
+        }
+    }
+
+    void HamerlyAssignmentEngine::classifyExactly(const double *point, const CentroidMatrix &centroids, const size_t index) {
+        const size_t numDimensions = centroids.numDimensions();
+
+        uint32_t label = 0;
+        double best = std::numeric_limits<double>::max();
+        double secondBest = std::numeric_limits<double>::max();
+        for (size_t centroid = 0; centroid < m_NumCentroids; ++centroid) {
+            const double distance = kernel::squaredEuclideanDistance(point, centroids.row(centroid), numDimensions);
+            if (distance < best) {
+                secondBest = best;
+                best = distance;
+                label = static_cast<uint32_t>(centroid);
+            } else if (distance < secondBest) {
+                secondBest = distance;
+            }
+        }
+
+        // the kernel works in squared distances, the bounds are real distances
+        m_Labels[index] = label;
+        m_UpperBounds[index] = std::sqrt(best);
+        m_LowerBounds[index] = std::sqrt(secondBest);
+    }
+
+    void HamerlyAssignmentEngine::assign(const PointMatrix &points, const CentroidMatrix &centroids, const size_t begin, const size_t end, CentroidMatrix &sums) {
+        PROFILE_FUNCTION();
+
+        if (m_Initializing) {
+            for (size_t index = begin; index < end; ++index) {
+                const double* point = points.row(index);
+                classifyExactly(point, centroids, index);
+                sums.accumulate(m_Labels[index], point);
+            }
+            m_DistanceEvaluations.fetch_add((end - begin) * m_NumCentroids, std::memory_order_relaxed);
+            return;
+        }
+
+        const size_t numDimensions = points.numDimensions();
+        uint64_t evaluations = 0;
+
+        for (size_t index = begin; index < end; ++index) {
+            const double* point = points.row(index);
+            const uint32_t label = m_Labels[index];
+
+            // shift the bounds by how far the centroids moved
+            double upper = m_UpperBounds[index] + m_Drift[label];
+            const double otherDrift = (label == m_MaxDriftCentroid) ? m_SecondMaxDrift : m_MaxDrift;
+            const double lower = std::max(0.0, m_LowerBounds[index] - otherDrift);
+
+            // nothing can be closer than the larger of the two bounds, so if we're under it, we stay put
+            const double threshold = std::max(m_HalfNearestCentroidDistance[label], lower);
+            if (upper > threshold) {
+                // tighten the upper bound to the real distance, and try again before paying for all k distances
+                upper = std::sqrt(kernel::squaredEuclideanDistance(point, centroids.row(label), numDimensions));
+                ++evaluations;
+                if (upper > threshold) {
+                    classifyExactly(point, centroids, index);
+                    evaluations += m_NumCentroids;
+                    sums.accumulate(m_Labels[index], point);
+                    continue;
+                }
+            }
+
+            m_UpperBounds[index] = upper;
+            m_LowerBounds[index] = lower;
+            sums.accumulate(label, point);
+        }
+
+        m_DistanceEvaluations.fetch_add(evaluations, std::memory_order_relaxed);
+    }
+
+} // kmeans
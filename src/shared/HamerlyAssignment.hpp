@@ -0,0 +1,73 @@
+//
+// Created by Matthew Krueger on 10/28/25.
+//
+
+#ifndef KMEANS_MPI_HAMERLYASSIGNMENT_HPP
+#define KMEANS_MPI_HAMERLYASSIGNMENT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AssignmentEngine.hpp"
+#include "PointMatrix.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief An exact assignment engine with a single upper and a single lower bound per point (Hamerly, 2010).
+     *
+     * Where Elkan keeps a lower bound for every centroid, Hamerly keeps one lower bound: on the distance to the SECOND
+     * closest centroid. Together with half the distance from each centroid to its nearest other centroid, that is enough
+     * to prove most points have not changed cluster without touching a single coordinate. When the bounds cannot prove
+     * it, all k distances are evaluated, so it prunes less than Elkan per point, but it only needs O(n) extra memory,
+     * so it streams far less data per iteration. That is the better trade in low to medium dimensionality.
+     *
+     * The labels it produces are the same as Lloyd's, up to ties between equidistant centroids.
+     */
+    class HamerlyAssignmentEngine final : public AssignmentEngine {
+    public:
+        void prepare(const PointMatrix& points, const CentroidMatrix& centroids) override;
+        void assign(const PointMatrix& points, const CentroidMatrix& centroids, size_t begin, size_t end, CentroidMatrix& sums) override;
+
+        /**
+         * @brief Gets the number of point to centroid distances actually evaluated since the engine was created.
+         */
+        [[nodiscard]] inline uint64_t getDistanceEvaluations() const { return m_DistanceEvaluations.load(std::memory_order_relaxed); }
+
+    private:
+        /**
+         * @brief Evaluates every distance for one point, and resets its label and both bounds from them.
+         */
+        void classifyExactly(const double* point, const CentroidMatrix& centroids, size_t index);
+
+        size_t m_NumPoints = 0;
+        size_t m_NumCentroids = 0;
+        const double* m_PointsSource = nullptr;
+        /// Whether this iteration has to build the bounds from scratch (first iteration, or new points)
+        bool m_Initializing = true;
+
+        std::vector<uint32_t> m_Labels;
+        /// Upper bound on the distance from each point to its assigned centroid
+        std::vector<double> m_UpperBounds;
+        /// Lower bound on the distance from each point to its second closest centroid
+        std::vector<double> m_LowerBounds;
+
+        /// The centroids the bounds are currently relative to, so we can measure how far each one moved
+        AlignedDoubleVector m_LastCentroids;
+        /// How far each centroid moved since the previous iteration
+        std::vector<double> m_Drift;
+        /// The largest drift, the centroid that had it, and the second largest drift
+        double m_MaxDrift = 0.0;
+        size_t m_MaxDriftCentroid = 0;
+        double m_SecondMaxDrift = 0.0;
+        /// Half the distance from each centroid to its nearest other centroid
+        std::vector<double> m_HalfNearestCentroidDistance;
+
+        std::atomic<uint64_t> m_DistanceEvaluations = 0;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_HAMERLYASSIGNMENT_HPP
@@ -0,0 +1,96 @@
+//
+// Created by Matthew Krueger on 10/31/25.
+//
+
+#include "Initialization.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "AssignmentKernel.hpp"
+#include "Instrumentation.hpp"
+
+namespace kmeans {
+
+    InitializationMethod parseInitializationMethod(const std::string &name) {
+        if (name == "random") {
+            return InitializationMethod::Random;
+        }
+        if (name == "kmeans++") {
+            return InitializationMethod::KMeansPlusPlus;
+        }
+        throw std::invalid_argument("Unknown initialization method: " + name);
+    }
+
+    const char* getInitializationMethodName(const InitializationMethod method) {
+        switch (method) {
+            case InitializationMethod::Random: return "random";
+            case InitializationMethod::KMeansPlusPlus: return "kmeans++";
+        }
+        return "unknown";
+    }
+
+    CentroidMatrix kMeansPlusPlus(const PointMatrix &points, const std::vector<double> &weights, const size_t numCentroids, std::mt19937 &rng) {
+        PROFILE_FUNCTION();
+
+        const size_t numPoints = points.numPoints();
+        const size_t numDimensions = points.numDimensions();
+        if (numCentroids > numPoints) {
+            throw std::invalid_argument("Cannot select more centroids than data points");
+        }
+        if (!weights.empty() && weights.size() != numPoints) {
+            throw std::invalid_argument("k-means++ needs exactly one weight per point");
+        }
+
+        const auto weightOf = [&weights](const size_t index) { return weights.empty() ? 1.0 : weights[index]; };
+
+        CentroidMatrix centroids(numCentroids, numDimensions);
+        if (numCentroids == 0) {
+            return centroids;
+        }
+
+        // draws an index with probability proportional to score(index). If every score is zero (every point already
+        // sits on a centroid), any point is as good as another, so fall back to uniform.
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        const auto draw = [&](const auto &score) {
+            double total = 0.0;
+            for (size_t index = 0; index < numPoints; ++index) {
+                total += score(index);
+            }
+            if (total <= 0.0) {
+                return std::uniform_int_distribution<size_t>(0, numPoints - 1)(rng);
+            }
+
+            const double target = unit(rng) * total;
+            double running = 0.0;
+            for (size_t index = 0; index < numPoints; ++index) {
+                running += score(index);
+                if (running > target) {
+                    return index;
+                }
+            }
+            return numPoints - 1; // only reachable through rounding
+        };
+
+        // the squared distance from every point to the closest centroid picked so far
+        std::vector<double> closest(numPoints, std::numeric_limits<double>::max());
+
+        size_t picked = draw(weightOf);
+        for (size_t centroid = 0; centroid < numCentroids; ++centroid) {
+            if (centroid > 0) {
+                picked = draw([&](const size_t index) { return weightOf(index) * closest[index]; });
+            }
+
+            std::copy_n(points.row(picked), numDimensions, centroids.row(centroid));
+            centroids.setCount(centroid, 1.0);
+
+            for (size_t index = 0; index < numPoints; ++index) {
+                closest[index] = std::min(closest[index], kernel::squaredEuclideanDistance(points.row(index), centroids.row(centroid), numDimensions));
+            }
+        }
+
+        return centroids;
+    }
+
+} // kmeans
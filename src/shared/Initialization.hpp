@@ -0,0 +1,66 @@
+//
+// Created by Matthew Krueger on 10/31/25.
+//
+
+#ifndef KMEANS_MPI_INITIALIZATION_HPP
+#define KMEANS_MPI_INITIALIZATION_HPP
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PointMatrix.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief Selects how the starting centroids are picked.
+     */
+    enum class InitializationMethod {
+        /// k distinct points, uniformly at random
+        Random,
+        /// k-means++ D^2 seeding. The MPI solver does the scalable variant, k-means||, across its ranks.
+        KMeansPlusPlus
+    };
+
+    /**
+     * @brief Parses an initialization method from its command line name.
+     * @param name Either "random" or "kmeans++"
+     * @return The method
+     * @throws std::invalid_argument if the name is not recognized
+     */
+    InitializationMethod parseInitializationMethod(const std::string& name);
+
+    /**
+     * @brief Gets the command line name of an initialization method.
+     */
+    const char* getInitializationMethodName(InitializationMethod method);
+
+    /// How many oversampling rounds k-means|| runs, at least. Bahmani et al. found ~5 is plenty in practice. It keeps
+    /// going past that while it has fewer than k candidates.
+    inline constexpr size_t KMEANS_PARALLEL_ROUNDS = 5;
+    /// How many candidates, as a multiple of k, k-means|| expects to pick per round
+    inline constexpr size_t KMEANS_PARALLEL_OVERSAMPLING = 2;
+
+    /**
+     * @brief Weighted k-means++ seeding (Arthur and Vassilvitskii, 2007).
+     *
+     * The first centroid is drawn with probability proportional to its weight, and every one after that with
+     * probability proportional to weight * D^2, where D is the distance to the closest centroid picked so far.
+     * It costs about one Lloyd iteration in total.
+     *
+     * If there are fewer than numCentroids distinct points with any weight, the leftover centroids repeat points.
+     *
+     * @param points The points to pick from
+     * @param weights One weight per point, or empty for all ones
+     * @param numCentroids How many centroids to pick. Must not be more than the number of points.
+     * @param rng The generator to pick with
+     * @return The centroids, each with a count of one
+     * @throws std::invalid_argument if there are more centroids than points, or the weights don't match the points
+     */
+    CentroidMatrix kMeansPlusPlus(const PointMatrix& points, const std::vector<double>& weights, size_t numCentroids, std::mt19937& rng);
+
+} // kmeans
+
+#endif //KMEANS_MPI_INITIALIZATION_HPP
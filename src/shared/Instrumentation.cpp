@@ -5,6 +5,7 @@
 #include "Instrumentation.hpp"
 
 #include <algorithm>
+#include <filesystem>
 #include <fstream>
 
 //#define DEBUG_INSTRUMENTATION
@@ -17,53 +18,217 @@
 #endif
 
 namespace instrumentation {
+    std::mutex NameTable::s_Mutex;
+    std::unordered_map<std::string, uint32_t> NameTable::s_IDs;
+    std::vector<std::string> NameTable::s_Names;
+
+    uint32_t NameTable::intern(const char *name) {
+        std::lock_guard lock(s_Mutex);
+        const auto [iterator, inserted] = s_IDs.try_emplace(name, static_cast<uint32_t>(s_Names.size()));
+        if (inserted) {
+            s_Names.emplace_back(name);
+        }
+        return iterator->second;
+    }
+
+    std::vector<std::string> NameTable::snapshot() {
+        std::lock_guard lock(s_Mutex);
+        return s_Names;
+    }
+
     std::shared_ptr<Instrumentor> Instrumentor::s_GlobalInstrumentor = nullptr;
+    std::atomic<Instrumentor*> Instrumentor::s_ActiveInstrumentor = nullptr;
+    std::atomic<uint64_t> Instrumentor::s_NextInstrumentorID = 1;
 
     std::weak_ptr<Instrumentor> Instrumentor::getGlobalInstrumentor() {
         return Instrumentor::s_GlobalInstrumentor;
     }
 
-    Instrumentor::Instrumentor(std::unique_ptr<Writer> &&writer) {
+    Instrumentor::Instrumentor(std::unique_ptr<Writer> &&writer, const Config &config) {
         m_Writer = std::move(writer);
+        m_Mode = config.mode;
+        m_PerfCounters = config.perfCounters;
+        m_ID = s_NextInstrumentorID.fetch_add(1, std::memory_order_relaxed);
+        if (m_Mode == ProfileMode::Trace) {
+            m_DrainThread = std::thread(&Instrumentor::drainLoop, this);
+        }
     }
 
-    void Instrumentor::recordEntry(Entry &&entry) {
-        m_LocalLog.push_back(std::move(entry));
+    ThreadLog &Instrumentor::getThreadLog() {
+        // each thread remembers its ring, along with which instrumentor it came from, so a new session starts fresh
+        thread_local uint64_t cachedOwner = 0;
+        thread_local ThreadLog* cachedLog = nullptr;
+
+        if (cachedOwner != m_ID) {
+            std::lock_guard lock(m_ThreadLogsMutex);
+            m_ThreadLogs.push_back(std::make_unique<ThreadLog>(m_Writer->getThreadID(), m_Mode, m_PerfCounters));
+            cachedLog = m_ThreadLogs.back().get();
+            cachedOwner = m_ID;
+
+            if (const PerfCounterGroup* counters = cachedLog->getCounterGroup()) {
+                m_CounterMask.fetch_or(counters->getAvailableMask(), std::memory_order_relaxed);
+
+                // every thread will most likely hit the same wall, so once per process is plenty
+                static std::once_flag warned;
+                if (!counters->getError().empty()) {
+                    std::call_once(warned, [&] {
+                        // built up first, so the processes' warnings don't get mixed together
+                        const std::string warning = "Process " + std::to_string(m_Writer->getProcessID()) + ": " + counters->getError()
+                                                  + (counters->getAvailableMask() == 0 ? ". Profiling without hardware counters.\n" : ". Profiling without that counter.\n");
+                        std::cerr << warning << std::flush;
+                    });
+                }
+            }
+        }
+        return *cachedLog;
+    }
+
+    bool Instrumentor::sampleCounters(CounterReading &reading) {
+        return getThreadLog().sampleCounters(reading);
+    }
+
+    void Instrumentor::record(const uint32_t nameID, const int64_t start, const int64_t end, const CounterSample *counters) {
+        ThreadLog &log = getThreadLog();
+        if (m_Mode == ProfileMode::Aggregate) {
+            log.accumulate(nameID, end - start, counters);
+            return;
+        }
+
+        const TraceRecord record{nameID, log.getThreadID(), start, end - start};
+
+        // a full ring means the drain thread has fallen behind. We'd rather slow down than lose the record
+        while (!log.tryPush(record, counters)) {
+            if (m_Stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+            requestDrain();
+            std::this_thread::yield();
+        }
+    }
+
+    void Instrumentor::requestDrain() {
+        {
+            std::lock_guard lock(m_DrainMutex);
+            m_DrainRequested = true;
+        }
+        m_DrainWakeup.notify_one();
+    }
+
+    void Instrumentor::drainLoop() {
+        std::unique_lock lock(m_DrainMutex);
+        while (true) {
+            m_DrainWakeup.wait_for(lock, DRAIN_PERIOD, [this] { return m_DrainRequested || m_Stopping.load(); });
+
+            // note the stop before draining, so the last pass picks up everything recorded before it
+            const bool stopping = m_Stopping.load();
+            const bool forceWrite = m_FlushRequested || stopping;
+            const uint64_t pass = ++m_DrainPassesStarted;
+            m_DrainRequested = false;
+            m_FlushRequested = false;
+
+            lock.unlock();
+            drainThreadLogs(forceWrite);
+            lock.lock();
+
+            m_DrainPassesDone = pass;
+            m_DrainPassDone.notify_all();
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    void Instrumentor::drainThreadLogs(const bool forceWrite) {
+        {
+            std::lock_guard lock(m_ThreadLogsMutex);
+            m_DrainScratch.clear();
+            for (const auto &log : m_ThreadLogs) {
+                m_DrainScratch.push_back(log.get());
+            }
+        }
+
+        for (ThreadLog* log : m_DrainScratch) {
+            log->drain([this](const TraceRecord &record, const CounterSample *counters) {
+                m_PendingRecords.push_back(record);
+                if (counters != nullptr) {
+                    m_PendingCounters.push_back(*counters);
+                }
+            });
+        }
 
         if constexpr (INSTRUMENTATION_DEBUG_INSTRUMENTATION) {
-            std::cout << "Wrote an instrumentation entry. Local Log Size: " << m_LocalLog.size() << " entries" <<
-                    std::endl;
+            std::cout << "Drained the thread logs. Pending: " << m_PendingRecords.size() << " records" << std::endl;
         }
 
-        if (m_LocalLog.size() > m_Writer->getTargetBufferSize()) {
-            flush();
+        // the writer gets the records in batches bigger than its target size, and whatever is left on a flush
+        if (!m_PendingRecords.empty() && (forceWrite || m_PendingRecords.size() > m_Writer->getTargetBufferSize())) {
+            m_Writer->write(m_PendingRecords, m_PendingCounters, m_CounterMask.load(std::memory_order_relaxed));
+            m_PendingRecords.clear();
+            m_PendingCounters.clear();
         }
     }
 
     Instrumentor::~Instrumentor() {
-        flush();
+        {
+            std::lock_guard lock(m_DrainMutex);
+            m_Stopping = true;
+        }
+        m_DrainWakeup.notify_one();
+        if (m_DrainThread.joinable()) {
+            m_DrainThread.join();
+        }
+
+        if (m_Mode == ProfileMode::Aggregate) {
+            m_Writer->writeSummary(NameTable::snapshot(), mergeThreadStatistics(), m_CounterMask.load(std::memory_order_relaxed));
+        }
         m_Writer->flush();
         // flush the writer too since it will go out of scope when this does. The writer will finalize itself on destruct however since it is not a global singleton
     }
 
 
+    std::vector<ScopeStatistics> Instrumentor::mergeThreadStatistics() {
+        std::lock_guard lock(m_ThreadLogsMutex);
+        std::vector<ScopeStatistics> merged;
+        for (const auto &log : m_ThreadLogs) {
+            const std::vector<ScopeStatistics> &statistics = log->getStatistics();
+            if (statistics.size() > merged.size()) {
+                merged.resize(statistics.size());
+            }
+            for (size_t nameID = 0; nameID < statistics.size(); ++nameID) {
+                merged[nameID] += statistics[nameID];
+            }
+        }
+        return merged;
+    }
+
     void Instrumentor::flush() {
+        std::unique_lock lock(m_DrainMutex);
         if constexpr (INSTRUMENTATION_DEBUG_INSTRUMENTATION) {
             std::cout << "Flushing Instrumentation Log" << std::endl;
         }
-        m_Writer->write(m_LocalLog);
-        m_LocalLog.clear();
+        if (m_Stopping || !m_DrainThread.joinable()) {
+            return; // the drain thread's last pass already took care of it, or there's no trace to drain
+        }
+
+        // a pass that already started may have missed our records, so wait for one that starts after this
+        const uint64_t needed = m_DrainPassesStarted + 1;
+        m_DrainRequested = true;
+        m_FlushRequested = true;
+        m_DrainWakeup.notify_one();
+        m_DrainPassDone.wait(lock, [&] { return m_DrainPassesDone >= needed; });
     }
 
-    void Instrumentor::initializeGlobalInstrumentor(std::unique_ptr<Writer> &&writer) {
+    void Instrumentor::initializeGlobalInstrumentor(std::unique_ptr<Writer> &&writer, const Config &config) {
         if (s_GlobalInstrumentor == nullptr) {
-            s_GlobalInstrumentor = std::make_shared<Instrumentor>(std::move(writer));
+            s_GlobalInstrumentor = std::make_shared<Instrumentor>(std::move(writer), config);
+            s_ActiveInstrumentor.store(s_GlobalInstrumentor.get(), std::memory_order_release);
         } else {
             std::cout << "Global Instrumentor already exists. Ignoring request." << std::endl;
         }
     }
 
     void Instrumentor::finalizeGlobalInstrumentor() {
+        s_ActiveInstrumentor.store(nullptr, std::memory_order_release);
         s_GlobalInstrumentor.reset(); // invalidate *all* instances of this instrumentor
     }
 }
@@ -90,182 +255,184 @@ namespace instrumentation {
         m_MyRank = std::numeric_limits<int>::max();
         m_Config = config;
 
-        MPI_Comm_rank(MPI_COMM_WORLD, &m_MyRank);
-        MPI_Comm_size(MPI_COMM_WORLD, &m_WorldSize);
-
-        m_WriteBuffer.reserve(config.targetBufferSize * 2); // Pre-allocate
-        m_Displacements.reserve(config.targetBufferSize);
-        m_EntrySizes.reserve(config.targetBufferSize);
+        // our own communicator, so nothing we send can ever match one of the program's own receives or collectives
+        MPI_Comm_dup(MPI_COMM_WORLD, &m_Communicator);
+        MPI_Comm_rank(m_Communicator, &m_MyRank);
+        MPI_Comm_size(m_Communicator, &m_WorldSize);
 
-        m_IsFirstFlush = true;
+        m_Records.reserve(SHARD_CHUNK_RECORDS); // Pre-allocate
     }
 
 
     MPIWriter::~MPIWriter() {
         flush();
-        if (m_MyRank == m_Config.mainRank) {
-                if (std::ofstream file(m_Config.logFileName, std::ios::app); file.is_open()) {
-                    write_tail(file);
-                }
+        mergeShards();
+        MPI_Comm_free(&m_Communicator);
+    }
 
-        }
+    std::string MPIWriter::getShardFileName(const std::string &logFileName, const int rank) {
+        return logFileName + "." + std::to_string(rank) + ".shard";
     }
 
-    void MPIWriter::write(const std::vector<Entry>& entries) {
+    void MPIWriter::write(const std::vector<TraceRecord>& records, const std::vector<CounterSample>& counters, const uint32_t counterMask) {
         if constexpr (INSTRUMENTATION_DEBUG_INSTRUMENTATION) {
-            std::cout << "Writing an MPIWriter entry." << std::endl;
+            std::cout << "Writing " << records.size() << " MPIWriter records." << std::endl;
+        }
+
+        m_Records.insert(m_Records.end(), records.begin(), records.end());
+        m_Counters.insert(m_Counters.end(), counters.begin(), counters.end());
+        m_CounterMask |= counterMask;
+        if (m_Records.size() >= std::max(SHARD_CHUNK_RECORDS, getTargetBufferSize())) {
+            writeChunk();
         }
+    }
 
-        // Append entries to m_WriteBuffer and track their starting positions and sizes
-        for (const auto& entry : entries) {
-            const std::string& entryText = entry.to_string();
-            if (!entryText.empty()) {
-                m_Displacements.push_back(static_cast<uint32_t>(m_WriteBuffer.size()));
-                m_EntrySizes.push_back(static_cast<uint32_t>(entryText.size()));
+    void MPIWriter::writeChunk() {
+        if (m_Records.empty() || m_ShardFailed) {
+            m_Records.clear();
+            m_Counters.clear();
+            return;
+        }
 
-                size_t oldSize = m_WriteBuffer.size();
-                m_WriteBuffer.resize(oldSize + entryText.size());
-                std::copy(entryText.begin(), entryText.end(), m_WriteBuffer.begin() + oldSize);
+        // the shard is only created once there's something to put in it
+        if (!m_Shard.is_open()) {
+            m_Shard.open(getShardFileName(m_Config.logFileName, m_MyRank), std::ios::binary | std::ios::trunc);
+            if (!m_Shard) {
+                std::cerr << "Could not open " << getShardFileName(m_Config.logFileName, m_MyRank) << ", so rank " << m_MyRank << " won't be in the trace" << std::endl;
+                m_ShardFailed = true;
+                m_Records.clear();
+                m_Counters.clear();
+                return;
             }
+            writeTraceFileHeader(m_Shard);
         }
 
-        if constexpr (INSTRUMENTATION_DEBUG_INSTRUMENTATION) {
-            std::cout << "Wrote an MPIWriter entry. Local Log Size: " << m_WriteBuffer.size() << " characters" << std::endl;
-            std::cout << "Displacements: " << m_Displacements.size() << std::endl;
-            std::cout << "Contents: ";
-            std::cout.write(m_WriteBuffer.data(), m_WriteBuffer.size());
-            std::cout << std::endl;
-        }
+        // every name in this chunk was interned before it was recorded, so the table as it is now covers all of them
+        const std::vector<std::string> names = NameTable::snapshot();
+        // and if the counters couldn't be opened anywhere, the chunk just doesn't carry any
+        const bool withCounters = m_Counters.size() == m_Records.size() && m_CounterMask != 0;
+        writeTraceChunk(m_Shard, static_cast<uint32_t>(m_MyRank), packNames(names), names.size(), m_Records.data(), m_Records.size(),
+                        withCounters ? m_Counters.data() : nullptr, withCounters ? m_CounterMask : 0);
+        m_Records.clear();
+        m_Counters.clear();
     }
 
     // Flush function
     void MPIWriter::flush() {
         if constexpr (INSTRUMENTATION_DEBUG_INSTRUMENTATION) {
-            std::cout << "Flushing MPIWriter. Local buffer size: " << m_WriteBuffer.size() << std::endl;
+            std::cout << "Flushing MPIWriter. Local records: " << m_Records.size() << std::endl;
         }
 
-        int local_size = static_cast<int>(m_WriteBuffer.size());
-        int local_entry_count = static_cast<int>(m_EntrySizes.size());
-
-        if (m_MyRank == m_Config.mainRank) {
-            if constexpr (INSTRUMENTATION_DEBUG_INSTRUMENTATION) {
-                std::cout << "Main rank flushing" << std::endl;
-            }
+        writeChunk();
+        if (m_Shard.is_open()) {
+            m_Shard.flush();
+        }
+    }
 
-            // Main rank: receive from all processes and write to file
-            std::vector<int> recv_counts(m_WorldSize, 0);
-            std::vector<int> entry_counts(m_WorldSize, 0);
-
-            // Gather total character counts and entry counts from all ranks
-            MPI_Gather(&local_size, 1, MPI_INT,
-                       recv_counts.data(), 1, MPI_INT,
-                       m_Config.mainRank, MPI_COMM_WORLD);
-            MPI_Gather(&local_entry_count, 1, MPI_INT,
-                       entry_counts.data(), 1, MPI_INT,
-                       m_Config.mainRank, MPI_COMM_WORLD);
-
-            // Calculate total size and displacements for data
-            std::vector<int> data_displacements(m_WorldSize, 0);
-            int total_size = 0;
-            for (int i = 0; i < m_WorldSize; ++i) {
-                data_displacements[i] = total_size;
-                total_size += recv_counts[i];
-            }
+    void MPIWriter::mergeShards() {
+        // this is the one place the ranks wait for each other. Each rank has closed its shard before it says so
+        int wroteShard = 0;
+        if (m_Shard.is_open()) {
+            m_Shard.close();
+            wroteShard = m_Shard ? 1 : 0;
+        }
 
-            // Calculate total entries and displacements for entry sizes
-            int total_entries = 0;
-            std::vector<int> entry_displacements(m_WorldSize, 0);
-            for (int i = 0; i < m_WorldSize; ++i) {
-                entry_displacements[i] = total_entries;
-                total_entries += entry_counts[i];
-            }
+        const bool isMain = m_MyRank == m_Config.mainRank;
+        std::vector<int> wroteShards(isMain ? m_WorldSize : 0);
+        MPI_Gather(&wroteShard, 1, MPI_INT, wroteShards.data(), 1, MPI_INT, m_Config.mainRank, m_Communicator);
 
-            // Allocate receive buffers
-            std::vector<char> recv_buffer(total_size);
-            std::vector<int> all_entry_sizes(total_entries);
-
-            // Gather entry sizes
-            MPI_Gatherv(m_EntrySizes.data(), local_entry_count, MPI_INT,
-                        all_entry_sizes.data(), entry_counts.data(), entry_displacements.data(), MPI_INT,
-                        m_Config.mainRank, MPI_COMM_WORLD);
-
-            // Gather actual data
-            MPI_Gatherv(m_WriteBuffer.data(), local_size, MPI_CHAR,
-                        recv_buffer.data(), recv_counts.data(), data_displacements.data(), MPI_CHAR,
-                        m_Config.mainRank, MPI_COMM_WORLD);
-
-            // Write to the appropriate destination
-            if (std::ofstream file(m_Config.logFileName, std::ios::app); file.is_open()) {
-                    if (m_IsFirstFlush) {
-                        write_preamble(file);
-                        m_IsFirstFlush = false;
-                    }
-                    writeEntriesToFile(recv_buffer, all_entry_sizes, file);
-                    file.flush();
-                }
+        if (!isMain) {
+            return;
+        }
 
-            if constexpr (INSTRUMENTATION_DEBUG_INSTRUMENTATION) {
-                std::cout << "Main rank finished flushing" << std::endl;
+        std::vector<std::filesystem::path> shards;
+        for (int rank = 0; rank < m_WorldSize; ++rank) {
+            if (wroteShards[rank]) {
+                shards.emplace_back(getShardFileName(m_Config.logFileName, rank));
             }
+        }
+        if (shards.empty()) {
+            return; // an aggregating session, or nothing was ever profiled
+        }
 
-        } else {
-            if constexpr (INSTRUMENTATION_DEBUG_INSTRUMENTATION) {
-                std::cout << "Non-main rank flushing" << std::endl;
+        const auto missing = std::ranges::find_if(shards, [](const std::filesystem::path &shard) { return !std::filesystem::exists(shard); });
+        if (m_Config.keepShards || missing != shards.end()) {
+            if (missing != shards.end()) {
+                std::cerr << "Can't see " << missing->string() << " from rank " << m_MyRank << ", so the trace shards were left as they are." << std::endl;
             }
+            std::cerr << "Merge the trace shards with: kmeans_trace_to_json " << getShardFileName(m_Config.logFileName, 0) << " ... " << m_Config.logFileName << std::endl;
+            return;
+        }
 
-            // Non-main ranks: send data to main rank
-            MPI_Gather(&local_size, 1, MPI_INT,
-                       nullptr, 0, MPI_INT,
-                       m_Config.mainRank, MPI_COMM_WORLD);
-            MPI_Gather(&local_entry_count, 1, MPI_INT,
-                       nullptr, 0, MPI_INT,
-                       m_Config.mainRank, MPI_COMM_WORLD);
-
-            if (local_size > 0) {
-                MPI_Gatherv(m_EntrySizes.data(), local_entry_count, MPI_INT,
-                            nullptr, nullptr, nullptr, MPI_INT,
-                            m_Config.mainRank, MPI_COMM_WORLD);
-                MPI_Gatherv(m_WriteBuffer.data(), local_size, MPI_CHAR,
-                            nullptr, nullptr, nullptr, MPI_CHAR,
-                            m_Config.mainRank, MPI_COMM_WORLD);
+        try {
+            if (m_Config.format == TraceFormat::Binary) {
+                mergeTraceFiles(shards, m_Config.logFileName);
+            } else {
+                convertTraceToChromeJson(shards, m_Config.logFileName);
             }
-
-            if constexpr (INSTRUMENTATION_DEBUG_INSTRUMENTATION) {
-                std::cout << "Non-main rank finished flushing" << std::endl;
+            for (const std::filesystem::path &shard : shards) {
+                std::filesystem::remove(shard);
             }
+        } catch (const std::exception &e) {
+            // this runs while the session is torn down, so all we can do is say so, and leave the shards be
+            std::cerr << e.what() << std::endl;
         }
+    }
 
-        // Ensure all ranks complete communication before clearing buffers
-        MPI_Barrier(MPI_COMM_WORLD);
+    void MPIWriter::writeSummary(const std::vector<std::string> &names, const std::vector<ScopeStatistics> &statistics, const uint32_t counterMask) {
+        // each rank's statistics go along with its names, since the main rank has to match them up by name
+        const std::vector<char> packedNames = packNames(names);
+        const int localCounts[2] = {static_cast<int>(statistics.size() * sizeof(ScopeStatistics)), static_cast<int>(packedNames.size())};
+
+        const bool isMain = m_MyRank == m_Config.mainRank;
+        std::vector<int> counts(isMain ? 2 * m_WorldSize : 0);
+        MPI_Gather(localCounts, 2, MPI_INT, counts.data(), 2, MPI_INT, m_Config.mainRank, m_Communicator);
+
+        // a counter shows up in the summary if any rank could count it. Ranks that couldn't just add zeros
+        unsigned int summaryCounterMask = 0;
+        const unsigned int localCounterMask = counterMask;
+        MPI_Reduce(&localCounterMask, &summaryCounterMask, 1, MPI_UNSIGNED, MPI_BOR, m_Config.mainRank, m_Communicator);
+
+        std::vector<int> statisticsBytes(m_WorldSize, 0), statisticsDisplacements(m_WorldSize, 0);
+        std::vector<int> nameBytes(m_WorldSize, 0), nameDisplacements(m_WorldSize, 0);
+        int totalStatisticsBytes = 0;
+        int totalNameBytes = 0;
+        if (isMain) {
+            for (int rank = 0; rank < m_WorldSize; ++rank) {
+                statisticsBytes[rank] = counts[2 * rank];
+                nameBytes[rank] = counts[2 * rank + 1];
+                statisticsDisplacements[rank] = totalStatisticsBytes;
+                nameDisplacements[rank] = totalNameBytes;
+                totalStatisticsBytes += statisticsBytes[rank];
+                totalNameBytes += nameBytes[rank];
+            }
+        }
 
-        // Clear buffers after flush
-        m_WriteBuffer.clear();
-        m_Displacements.clear();
-        m_EntrySizes.clear();
-    }
+        std::vector<ScopeStatistics> allStatistics(totalStatisticsBytes / sizeof(ScopeStatistics));
+        std::vector<char> allNames(totalNameBytes);
+        MPI_Gatherv(statistics.data(), localCounts[0], MPI_BYTE,
+                    allStatistics.data(), statisticsBytes.data(), statisticsDisplacements.data(), MPI_BYTE,
+                    m_Config.mainRank, m_Communicator);
+        MPI_Gatherv(packedNames.data(), localCounts[1], MPI_CHAR,
+                    allNames.data(), nameBytes.data(), nameDisplacements.data(), MPI_CHAR,
+                    m_Config.mainRank, m_Communicator);
 
-    void MPIWriter::writeEntriesToFile(const std::vector<char>& all_data, const std::vector<int>& entry_sizes, std::ostream& file) {
-        if (all_data.empty() || entry_sizes.empty()) {
+        if (!isMain) {
             return;
         }
 
-        bool first_entry = true;
-        size_t offset = 0;
-
-        for (size_t i = 0; i < entry_sizes.size(); ++i) {
-            if (entry_sizes[i] == 0) {
-                continue; // Skip empty entries
-            }
-            if (offset + entry_sizes[i] > all_data.size()) {
-                break; // Prevent buffer overrun
-            }
+        std::vector<NamedScopeStatistics> summary;
+        for (int rank = 0; rank < m_WorldSize; ++rank) {
+            mergeScopeStatistics(summary, unpackNames(allNames.data() + nameDisplacements[rank], nameBytes[rank]),
+                                 allStatistics.data() + statisticsDisplacements[rank] / sizeof(ScopeStatistics), statisticsBytes[rank] / sizeof(ScopeStatistics));
+        }
 
-            if (!first_entry) {
-                file << COMMA_NEWLINE;
-            }
-            file.write(all_data.data() + offset, entry_sizes[i]);
-            first_entry = false;
-            offset += entry_sizes[i];
+        printScopeStatistics(std::cout, summary, m_WorldSize, summaryCounterMask);
+        try {
+            writeScopeStatisticsJson(m_Config.summaryFileName, summary, m_WorldSize, summaryCounterMask);
+        } catch (const std::runtime_error &e) {
+            // this runs while the session is torn down, so all we can do is say so
+            std::cerr << e.what() << std::endl;
         }
     }
 
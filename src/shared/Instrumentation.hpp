@@ -5,106 +5,57 @@
 #ifndef KMEANS_MPI_INSTRUMENTATION_HPP
 #define KMEANS_MPI_INSTRUMENTATION_HPP
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <variant>
 #include <cstring>
 #include <sstream>
 #include <functional>
 
-//#define BUILD_WITH_PROFILING
-
-
-namespace instrumentation {
-
-    inline const char* cStringEscape(const char* toEscape){
-
-        static char buffer[4096];
-
-        strcpy(buffer, toEscape);
-        size_t originalIndex = 0;
-        size_t originalSize = strlen(toEscape);
-        size_t index = 0;
-        for(originalIndex = 0; originalIndex<originalSize; ++originalIndex){
-            char currentChar = toEscape[originalIndex];
-
-            if(toEscape[originalIndex] != buffer[index]){
-                exit(-1);
-            }
-
-            if(currentChar == '\"'){
-                buffer[index] = '\\';
-                ++index;
-                buffer[index] = '\0';
-                // now copy the string from this point onwards
-                strcat(&buffer[index],&toEscape[originalIndex]);
-            }
-
-            // remember to increment the original index
-            ++index;
-        }
+#include "PerfCounters.hpp"
+#include "ProfileSummary.hpp"
+#include "TraceFormat.hpp"
 
-        return buffer;
+#ifdef BUILD_WITH_MPI
+#include <mpi.h>
+#endif
 
-    }
+//#define BUILD_WITH_PROFILING
 
 
+namespace instrumentation {
 
-    class Entry {
+    /**
+     * @brief Hands out a small ID for every distinct scope name, so a record carries 4 bytes instead of a string.
+     *
+     * PROFILE_SCOPE interns its name once per call site, the first time it runs, so the recording path never sees a
+     * string at all. IDs are per process, which is why every chunk of a trace carries its process's table.
+     */
+    class NameTable {
     public:
-        struct ProfileResult{
-            const char* name;
-            long long start, end;
-            uint32_t threadID;
-            uint32_t processID;
-        };
-
         /**
-         * @brief A wrapper for a string representing a log entry.
-         *
-         * This is specifically a wrapper IN ORDER THAT it may be extendable in the future.
-         * @param m_Value A serialized version of the log entry. In the case of Chrome Tracer logs, this is the log without a comma
+         * @brief Gets the ID of a name, adding it if it has never been seen. Thread safe, but takes a lock.
          */
-        explicit Entry(std::string m_Value) : m_Value(std::move(m_Value)){};
-        Entry(Entry&& other) noexcept = default;
-        Entry(const Entry& other) = default;
-        Entry(const ProfileResult& result) { // NOLINT(*-explicit-constructor)
-
-            const char* name = cStringEscape(result.name);
-
-            std::ostringstream oss;
-            oss << "{";
-            oss << R"("cat":"function",)";
-            oss << "\"dur\":" << (result.end - result.start) << ',';
-            oss << R"("name":")" << name << "\",";
-            oss << R"("ph":"X",)";
-            oss << "\"pid\":" << result.processID << ",";
-            oss << "\"tid\":" << result.threadID << ",";
-            oss << "\"ts\":" << result.start;
-            oss << "}";
-
-            m_Value = oss.str();
-        }
-
-        ~Entry() = default;
-
-        Entry& operator=(const Entry&) = default;
-        Entry& operator=(Entry&&) = default;
-        Entry& operator=(std::string&&) = delete;
-
-        inline const std::string& operator*() const{ return m_Value; }
-
-        [[nodiscard]] inline const std::string& to_string() const {
-            return m_Value;
-        };
+        static uint32_t intern(const char* name);
 
-        friend std::ostream& operator<<(std::ostream& os, const Entry& entry) { os << entry.m_Value; return os; }
+        /**
+         * @brief Every name interned so far, indexed by ID.
+         */
+        static std::vector<std::string> snapshot();
 
     private:
-        std::string m_Value;
+        static std::mutex s_Mutex;
+        static std::unordered_map<std::string, uint32_t> s_IDs;
+        static std::vector<std::string> s_Names;
     };
 
     class Writer{
@@ -113,15 +64,31 @@ namespace instrumentation {
         explicit Writer(size_t targetBufferSize) : m_TargetBufferSize(targetBufferSize) {};
         virtual ~Writer() {}
 
-        virtual void write(const std::vector<Entry>& entries) = 0;
+        /**
+         * @brief Takes a batch of raw records. Called from the Instrumentor's drain thread, never a measured one.
+         * @param records The records
+         * @param counters One hardware counter sample per record, or empty if the session isn't reading counters
+         * @param counterMask Which of the counters were actually counted, so far, by any thread
+         */
+        virtual void write(const std::vector<TraceRecord>& records, const std::vector<CounterSample>& counters, uint32_t counterMask) = 0;
+
+        /**
+         * @brief Takes the statistics of an aggregating session (ProfileMode::Aggregate), once, as the session ends.
+         *
+         * Called from the thread ending the session, so, like flush(), it may block on other processes.
+         * @param names The name table, indexed by name ID
+         * @param statistics Every thread's statistics summed, indexed by name ID. May be shorter than names.
+         * @param counterMask Which hardware counters were counted, by any thread
+         */
+        virtual void writeSummary(const std::vector<std::string>& names, const std::vector<ScopeStatistics>& statistics, uint32_t counterMask) = 0;
         virtual uint32_t getThreadID() { return std::hash<std::thread::id>{}(std::this_thread::get_id()); }
         virtual uint32_t getProcessID() { return 0; }
 
         /**
          *  @brief Flushes the buffer to the disk.
          *
-         * In distributed memory environments, dysfunction will also synchronize everything to the main thread.
-         * This means it is imperative to call this manually or at destruction, as it will block.
+         * Only ever writes this process's own records, so it never waits on another process. Anything that has to bring
+         * the processes together happens once, when the writer is destroyed at the end of the session.
          */
         virtual void flush() = 0;
 
@@ -137,9 +104,132 @@ namespace instrumentation {
 
 #endif
 
+    /**
+     * @brief A fixed-capacity ring of raw timing records, written by exactly one thread and read by exactly one other.
+     *
+     * The owning thread pushes, and only the Instrumentor's drain thread pops, so neither end ever takes a lock. Each
+     * end only writes its own index, and publishes it with a release store the other end picks up with an acquire load.
+     * The two indices live on their own cache lines, so the producer and the consumer don't fight over one.
+     *
+     * The indices only ever count up, and are masked into the ring, which is why the capacity is a power of two.
+     *
+     * In an aggregating session there is no ring at all, just the thread's ScopeStatistics for every name ID, which
+     * only the owning thread touches until the session ends.
+     *
+     * When the session reads hardware counters, the log also holds the thread's PerfCounterGroup, and in a tracing
+     * session, a second ring of CounterSamples, one per record, filled and emptied in step with the first.
+     */
+    class ThreadLog {
+    public:
+        static constexpr size_t CAPACITY = 1 << 14;
+
+        ThreadLog(uint32_t threadID, ProfileMode mode, bool perfCounters)
+            : m_Records(mode == ProfileMode::Trace ? std::make_unique<TraceRecord[]>(CAPACITY) : nullptr),
+              m_Counters(mode == ProfileMode::Trace && perfCounters ? std::make_unique<CounterSample[]>(CAPACITY) : nullptr),
+              m_CounterGroup(perfCounters ? std::make_unique<PerfCounterGroup>() : nullptr),
+              m_ThreadID(threadID) {}
+        ThreadLog(const ThreadLog&) = delete;
+        ThreadLog& operator=(const ThreadLog&) = delete;
+
+        /**
+         * @brief Appends a record. Only ever called by the owning thread.
+         * @param record The record
+         * @param counters The record's counter sample, or null for none (zeros, if this log keeps counters)
+         * @return false, and nothing is written, if the ring is full
+         */
+        inline bool tryPush(const TraceRecord& record, const CounterSample* counters = nullptr) noexcept {
+            const size_t head = m_Head.load(std::memory_order_relaxed);
+            if (head - m_Tail.load(std::memory_order_acquire) == CAPACITY) {
+                return false;
+            }
+            m_Records[head & (CAPACITY - 1)] = record;
+            if (m_Counters) {
+                m_Counters[head & (CAPACITY - 1)] = counters != nullptr ? *counters : CounterSample{};
+            }
+            m_Head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Hands every record pushed so far to consumer, oldest first, along with its counter sample (null if
+         * this log keeps none), and frees their slots. Only ever called by the drain thread.
+         */
+        template<typename Consumer>
+        void drain(Consumer&& consumer) {
+            const size_t tail = m_Tail.load(std::memory_order_relaxed);
+            const size_t head = m_Head.load(std::memory_order_acquire);
+            for (size_t index = tail; index != head; ++index) {
+                consumer(m_Records[index & (CAPACITY - 1)], m_Counters ? &m_Counters[index & (CAPACITY - 1)] : nullptr);
+            }
+            m_Tail.store(head, std::memory_order_release);
+        }
+
+        /**
+         * @brief Adds one call to the statistics of a scope site. Only ever called by the owning thread.
+         */
+        inline void accumulate(const uint32_t nameID, const int64_t duration, const CounterSample* counters = nullptr) {
+            if (nameID >= m_Statistics.size()) {
+                m_Statistics.resize(nameID + 1); // only the first time this thread closes a scope with this name
+            }
+            m_Statistics[nameID].add(duration, counters);
+        }
+
+        /**
+         * @brief Reads the thread's hardware counters. Only ever called by the owning thread.
+         * @return false if this log has no counters, or none of them could be opened
+         */
+        inline bool sampleCounters(CounterReading& reading) const {
+            return m_CounterGroup && m_CounterGroup->read(reading);
+        }
+
+        /// The thread's counter group, or null if the session isn't reading counters
+        [[nodiscard]] inline const PerfCounterGroup* getCounterGroup() const { return m_CounterGroup.get(); }
+
+        [[nodiscard]] inline const std::vector<ScopeStatistics>& getStatistics() const { return m_Statistics; }
+
+        [[nodiscard]] inline uint32_t getThreadID() const { return m_ThreadID; }
+
+    private:
+        std::unique_ptr<TraceRecord[]> m_Records;
+        std::unique_ptr<CounterSample[]> m_Counters;
+        std::unique_ptr<PerfCounterGroup> m_CounterGroup;
+        std::vector<ScopeStatistics> m_Statistics;
+        alignas(64) std::atomic<size_t> m_Head{0};
+        alignas(64) std::atomic<size_t> m_Tail{0};
+        alignas(64) uint32_t m_ThreadID;
+    };
+
+    /**
+     * @brief Collects the timing records of every thread, and hands them to a Writer from a thread of its own.
+     *
+     * Each thread gets its own ThreadLog the first time it records, which is the only time recording allocates or
+     * locks anything. From then on, recording a scope is a push of one TraceRecord into that ring. The drain thread
+     * wakes up every DRAIN_PERIOD (or sooner, when a ring fills up), empties every ring, and hands the records to the
+     * Writer, so the Writer never runs on a thread being measured. Nothing is formatted until the Writer flushes.
+     *
+     * The Writer is only ever touched by the drain thread while it runs, and its flush() (which may be collective)
+     * is called from the thread that destroys the Instrumentor, once the drain thread has stopped.
+     *
+     * In an aggregating session (ProfileMode::Aggregate) there are no records and no drain thread. Each thread just
+     * adds every scope it closes into its own ScopeStatistics, and when the session ends, the threads are summed up
+     * and handed to Writer::writeSummary().
+     *
+     * With perfCounters, every scope also reads the thread's hardware counters (see PerfCounterGroup) when it opens
+     * and when it closes, and the difference goes along with the record, or into the statistics. That's two system
+     * calls per scope, so it is best kept for sessions where the counters are the point. Where the counters can't be
+     * opened, the session carries on without them.
+     */
     class Instrumentor {
     public:
-        explicit Instrumentor(std::unique_ptr<Writer>&& writer);
+        static constexpr std::chrono::milliseconds DRAIN_PERIOD{5};
+
+        struct Config {
+            ProfileMode mode = ProfileMode::Trace;
+            /// Read the hardware counters around every scope
+            bool perfCounters = false;
+        };
+
+        Instrumentor(std::unique_ptr<Writer>&& writer, const Config& config);
         Instrumentor(const Instrumentor&) = delete;
         Instrumentor(Instrumentor &&) = delete;
         ~Instrumentor();
@@ -148,41 +238,118 @@ namespace instrumentation {
         Instrumentor& operator=(Instrumentor&&) = delete;
         Instrumentor& operator=(std::unique_ptr<Writer>&& writer) = delete;
 
-        void recordEntry(Entry&& entry);
+        /**
+         * @brief Records one finished scope on the calling thread's ring, or adds it to the thread's statistics.
+         *
+         * If the ring is full, this wakes the drain thread and waits for room rather than dropping the record.
+         */
+        void record(uint32_t nameID, int64_t start, int64_t end, const CounterSample* counters = nullptr);
+
+        /// Whether scopes should read the hardware counters at all
+        [[nodiscard]] inline bool readsPerfCounters() const { return m_PerfCounters; }
+
+        /**
+         * @brief Reads the calling thread's hardware counters.
+         * @return false if there are no counters to read on this thread
+         */
+        bool sampleCounters(CounterReading& reading);
+
+        /**
+         * @brief Blocks until everything recorded before the call has been handed to the Writer.
+         */
         void flush();
         std::unique_ptr<Writer>& getWriter() { return m_Writer; }
 
         static std::weak_ptr<Instrumentor> getGlobalInstrumentor();
-        static void initializeGlobalInstrumentor(std::unique_ptr<Writer>&& writer);
+
+        /**
+         * @brief The global instrumentor, as a plain pointer, for the recording path. Null outside of a session.
+         *
+         * Unlike getGlobalInstrumentor(), this doesn't touch a reference count shared by every thread.
+         */
+        static inline Instrumentor* getActiveInstrumentor() { return s_ActiveInstrumentor.load(std::memory_order_acquire); }
+
+        static void initializeGlobalInstrumentor(std::unique_ptr<Writer>&& writer, const Config& config);
+
+        /**
+         * @brief Ends the session. Every profiled thread other than the caller must be idle by now.
+         */
         static void finalizeGlobalInstrumentor();
 
     private:
-
+        /// The calling thread's ring, registering a new one the first time a thread records
+        ThreadLog& getThreadLog();
+        void drainLoop();
+        /// Empties every ring into the Writer. Only ever called by the drain thread.
+        void drainThreadLogs(bool forceWrite);
+        void requestDrain();
+        /// Sums the statistics of every thread, by name ID
+        std::vector<ScopeStatistics> mergeThreadStatistics();
 
         static std::shared_ptr<Instrumentor> s_GlobalInstrumentor;
+        static std::atomic<Instrumentor*> s_ActiveInstrumentor;
+        static std::atomic<uint64_t> s_NextInstrumentorID;
 
         std::unique_ptr<Writer> m_Writer;
-        std::vector<Entry> m_LocalLog;
+        ProfileMode m_Mode;
+        bool m_PerfCounters;
+        /// Every counter that some thread managed to open
+        std::atomic<uint32_t> m_CounterMask = 0;
+        /// Tells the per-thread cache of ThreadLog pointers which instrumentor they belong to
+        uint64_t m_ID;
+
+        /// Every ring ever registered. They outlive their threads, so nothing recorded by a finished thread is lost.
+        std::vector<std::unique_ptr<ThreadLog>> m_ThreadLogs;
+        std::mutex m_ThreadLogsMutex;
+
+        /// Drain thread only: records (and their counters) not yet handed to the Writer, and the rings to visit this pass
+        std::vector<TraceRecord> m_PendingRecords;
+        std::vector<CounterSample> m_PendingCounters;
+        std::vector<ThreadLog*> m_DrainScratch;
+
+        std::mutex m_DrainMutex;
+        std::condition_variable m_DrainWakeup;
+        std::condition_variable m_DrainPassDone;
+        bool m_DrainRequested = false;
+        bool m_FlushRequested = false;
+        std::atomic<bool> m_Stopping = false;
+        uint64_t m_DrainPassesStarted = 0;
+        uint64_t m_DrainPassesDone = 0;
+        std::thread m_DrainThread;
 
     };
 
     class Session {
     public:
-        inline explicit Session(const char* name) : m_Name(name), m_StartTime(getTimePoint()), m_Stopped(false) {};
+        /**
+         * @param nameID The name of the scope, from NameTable::intern()
+         */
+        inline explicit Session(const uint32_t nameID) : m_NameID(nameID), m_StartTime(getTimePoint()), m_Stopped(false) {
+            // the counters are read after the clock on the way in, and before it on the way out, so the time includes
+            // reading them, but the counts don't
+            if (Instrumentor* instrumentor = Instrumentor::getActiveInstrumentor(); instrumentor && instrumentor->readsPerfCounters()) {
+                m_HasCounters = instrumentor->sampleCounters(m_StartCounters);
+            }
+        };
         ~Session() {
             stop();
         };
 
         inline void stop(){
             if (!m_Stopped) {
+                Instrumentor* instrumentor = Instrumentor::getActiveInstrumentor();
+                CounterReading endCounters;
+                const bool hasReading = m_HasCounters && instrumentor && instrumentor->sampleCounters(endCounters);
+
                 auto endTimepoint = getTimePoint();
 
-                long long end = convertTimepointToMicroseconds(endTimepoint);
+                int64_t end = convertTimepointToNanoseconds(endTimepoint);
 
-                if (auto instrumentor = Instrumentor::getGlobalInstrumentor().lock()) {
-                    uint32_t threadID = instrumentor->getWriter()->getThreadID();
-                    uint32_t processID = instrumentor->getWriter()->getProcessID();
-                    instrumentor->recordEntry(Entry::ProfileResult{m_Name, convertTimepointToMicroseconds(m_StartTime), end, threadID, processID});
+                if (instrumentor) {
+                    // a scope the counters were multiplexed out for the whole of goes without them
+                    CounterSample counters;
+                    const bool hasCounters = hasReading && counterDifference(m_StartCounters, endCounters, counters);
+                    instrumentor->record(m_NameID, convertTimepointToNanoseconds(m_StartTime), end, hasCounters ? &counters : nullptr);
                 }
 
                 m_Stopped = true;
@@ -191,13 +358,13 @@ namespace instrumentation {
 
 
     private:
-        inline static long long convertTimepointToMicroseconds(std::variant<std::chrono::time_point<std::chrono::high_resolution_clock>, double> startTimepoint) {
+        inline static int64_t convertTimepointToNanoseconds(std::variant<std::chrono::time_point<std::chrono::high_resolution_clock>, double> startTimepoint) {
             if (std::holds_alternative<double>(startTimepoint)) {
                 // we are using MPI for the session
-                // convert seconds to microseconds
-                return static_cast<long long>(std::get<double>(startTimepoint) * 1e6);
+                // convert seconds to nanoseconds
+                return static_cast<int64_t>(std::get<double>(startTimepoint) * 1e9);
             }else if (std::holds_alternative<std::chrono::time_point<std::chrono::high_resolution_clock>>(startTimepoint)) {
-                return std::chrono::time_point_cast<std::chrono::microseconds>(std::get<std::chrono::time_point<std::chrono::high_resolution_clock>>(startTimepoint)).time_since_epoch().count();
+                return std::chrono::time_point_cast<std::chrono::nanoseconds>(std::get<std::chrono::time_point<std::chrono::high_resolution_clock>>(startTimepoint)).time_since_epoch().count();
             }else {
                 throw std::runtime_error("Unknown timepoint type");
             }
@@ -205,51 +372,80 @@ namespace instrumentation {
 
         static std::variant<std::chrono::time_point<std::chrono::high_resolution_clock>, double> getTimePoint();
 
-        const char* m_Name;
+        uint32_t m_NameID;
         std::variant<std::chrono::time_point<std::chrono::high_resolution_clock>, double> m_StartTime;
         bool m_Stopped;
+        bool m_HasCounters = false;
+        CounterReading m_StartCounters;
 
     };
 
 #ifdef BUILD_WITH_MPI
+    /**
+     * @brief Has every rank write its own records to its own shard file, and puts the shards together at the very end.
+     *
+     * While the session runs, nothing here talks to another rank. Records are buffered, and every SHARD_CHUNK_RECORDS
+     * (and on flush) they are appended to this rank's shard, logFileName.<rank>.shard, as a chunk of a binary trace,
+     * all from the Instrumentor's drain thread. A rank whose buffer fills up just writes, and nobody else waits for it.
+     *
+     * When the writer is destroyed, the ranks report whether they wrote a shard, and the main rank merges the shards
+     * into logFileName, as a Chrome trace or (with TraceFormat::Binary) a binary trace, and removes them. That needs
+     * the shards to be on a file system the main rank can see. If it can't, or with keepShards, they are left where
+     * they are, for kmeans_trace_to_json to merge later.
+     *
+     * An aggregating session's statistics are gathered to the main rank when the session ends, merged, printed as a
+     * table and written to summaryFileName.
+     *
+     * All of the writer's own communication is on a duplicate of MPI_COMM_WORLD, so it can never get mixed up with the
+     * program's.
+     */
     class MPIWriter final : public Writer {
     public:
+        /// Records per chunk of a shard. Each chunk repeats the name table, so they shouldn't be too small.
+        static constexpr size_t SHARD_CHUNK_RECORDS = 1 << 16;
+
         struct Config{
             std::string logFileName;
             int mainRank;
             int logTag;
             size_t targetBufferSize;
+            TraceFormat format = TraceFormat::ChromeJson;
+            /// Where the main rank writes the statistics of an aggregating session, as JSON
+            std::string summaryFileName = "profile.json";
+            /// Leave every rank's shard as it is at the end, instead of merging them into logFileName
+            bool keepShards = false;
         };
 
         explicit MPIWriter(const Config& config);
         ~MPIWriter() override;
 
-        void write(const std::vector<Entry>& entries) override;
+        void write(const std::vector<TraceRecord>& records, const std::vector<CounterSample>& counters, uint32_t counterMask) override;
+        void writeSummary(const std::vector<std::string>& names, const std::vector<ScopeStatistics>& statistics, uint32_t counterMask) override;
         void flush() override;
 
         uint32_t getProcessID() override;
 
+        /**
+         * @brief The shard a rank writes its records to.
+         */
+        [[nodiscard]] static std::string getShardFileName(const std::string& logFileName, int rank);
+
     private:
+        /// Appends the buffered records to this rank's shard as one chunk
+        void writeChunk();
+        /// Brings the shards together on the main rank. Collective, and only run once, from the destructor.
+        void mergeShards();
+
         Config m_Config;
-        std::vector<char> m_WriteBuffer;      // Stores concatenated entry strings as chars
-        std::vector<uint32_t> m_Displacements; // Tracks start position of each entry
-        std::vector<uint32_t> m_EntrySizes;   // Tracks size of each entry
+        MPI_Comm m_Communicator = MPI_COMM_NULL;
+        std::vector<TraceRecord> m_Records;
+        /// Parallel to m_Records when the session reads counters, and empty when it doesn't
+        std::vector<CounterSample> m_Counters;
+        uint32_t m_CounterMask = 0;
+        std::ofstream m_Shard;
+        bool m_ShardFailed = false;
         int m_MyRank;
         int m_WorldSize;
-        bool m_IsFirstFlush = true;
-        static constexpr const char* PREAMBLE = "[\n";
-        static constexpr const char* TAIL = "\n]";
-        static constexpr const char* COMMA_NEWLINE = ",\n";
-
-        static void write_preamble(std::ostream& file) {
-            file << PREAMBLE;
-        }
-
-        static void write_tail(std::ostream& file) {
-            file << TAIL;
-        }
-
-        static void writeEntriesToFile(const std::vector<char>& all_data, const std::vector<int>& global_displacements, std::ostream& file);
     };
 #endif
 
@@ -262,12 +458,17 @@ namespace instrumentation {
 #define _PROFILE_FUNCTION_NAME                    __FUNCSIG__
 #endif
 #define __PROFILE_TIMER_NAME                       timer
-#define PROFILE_BEGIN_SESSION(writer)             ::instrumentation::Instrumentor::initializeGlobalInstrumentor(writer)
+// two levels, so __LINE__ is expanded before it's pasted on. With just ##, every scope would be called profileName__LINE__
+#define __PROFILE_CONCAT_INNER(a, b)               a##b
+#define __PROFILE_CONCAT(a, b)                     __PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_BEGIN_SESSION(writer)             ::instrumentation::Instrumentor::initializeGlobalInstrumentor(writer, ::instrumentation::Instrumentor::Config{})
+#define PROFILE_BEGIN_SESSION_WITH_CONFIG(writer, config) ::instrumentation::Instrumentor::initializeGlobalInstrumentor(writer, config)
 #define PROFILE_END_SESSION()                     ::instrumentation::Instrumentor::finalizeGlobalInstrumentor()
-#define PROFILE_SCOPE(name)                       ::instrumentation::Session session##__LINE__(name)
+#define PROFILE_SCOPE(name)                       static const uint32_t __PROFILE_CONCAT(profileName, __LINE__) = ::instrumentation::NameTable::intern(name); ::instrumentation::Session __PROFILE_CONCAT(session, __LINE__)(__PROFILE_CONCAT(profileName, __LINE__))
 #define PROFILE_FUNCTION()                        PROFILE_SCOPE(__PROFILE_FUNCTION_NAME)
 #else
 #define PROFILE_BEGIN_SESSION(writer)             (void(0))
+#define PROFILE_BEGIN_SESSION_WITH_CONFIG(writer, config) (void(0))
 #define PROFILE_END_SESSION()                     (void(0))
 #define PROFILE_FUNCTION()                        (void(0))
 #define PROFILE_SCOPE(name)                       (void(0))
@@ -0,0 +1,54 @@
+//
+// Created by Matthew Krueger on 10/30/25.
+//
+
+#include "MiniBatch.hpp"
+
+#include "AssignmentKernel.hpp"
+#include "Instrumentation.hpp"
+
+namespace kmeans {
+
+    double accumulateMiniBatch(const PointMatrix &points, const CentroidMatrix &centroids, const size_t batchSize, std::mt19937 &rng, CentroidMatrix &batchSums) {
+        PROFILE_FUNCTION();
+
+        // a rank can legitimately end up with no points at all, and it still has to take part in the reduction
+        if (points.numPoints() == 0) {
+            return 0.0;
+        }
+
+        double inertia = 0.0;
+        std::uniform_int_distribution<size_t> dist(0, points.numPoints() - 1);
+        for (size_t sample = 0; sample < batchSize; ++sample) {
+            const double* point = points.row(dist(rng));
+            const auto nearest = kernel::findNearestCentroid(point, centroids.coordinates(), centroids.numCentroids(), centroids.numDimensions());
+            batchSums.accumulate(nearest.index, point);
+            inertia += nearest.squaredDistance;
+        }
+        return inertia;
+    }
+
+    bool MiniBatchConvergence::update(const double batchInertia, const double batchCount) {
+        if (batchCount == 0.0) {
+            return false;
+        }
+
+        const double inertia = batchInertia / batchCount;
+        if (!m_State.started) {
+            m_State.averageInertia = inertia;
+            m_State.bestAverageInertia = inertia;
+            m_State.started = true;
+            return false;
+        }
+
+        m_State.averageInertia = (1.0 - SMOOTHING) * m_State.averageInertia + SMOOTHING * inertia;
+        if (m_State.averageInertia < m_State.bestAverageInertia) {
+            m_State.bestAverageInertia = m_State.averageInertia;
+            m_State.batchesWithoutImprovement = 0;
+        } else {
+            ++m_State.batchesWithoutImprovement;
+        }
+        return m_State.batchesWithoutImprovement >= PATIENCE;
+    }
+
+} // kmeans
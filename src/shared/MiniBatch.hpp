@@ -0,0 +1,75 @@
+//
+// Created by Matthew Krueger on 10/30/25.
+//
+
+#ifndef KMEANS_MPI_MINIBATCH_HPP
+#define KMEANS_MPI_MINIBATCH_HPP
+
+#include <cstddef>
+#include <random>
+
+#include "PointMatrix.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief Samples a mini-batch of points, classes each one, and accumulates it.
+     *
+     * The points are drawn uniformly, with replacement, so a batch costs O(batchSize * k * d) no matter how large the
+     * dataset is. Together with CentroidMatrix::applyMiniBatch() this is one step of mini-batch k-means.
+     *
+     * The bound-based assignment engines are no use here, since their bounds belong to a fixed set of points, and every
+     * batch is a different set. So this always goes through the plain nearest centroid kernel.
+     *
+     * @param points The points to sample from. If it is empty, nothing is sampled.
+     * @param centroids The centroids to class against
+     * @param batchSize How many points to sample
+     * @param rng The generator to sample with. It is advanced, so consecutive batches differ.
+     * @param batchSums The accumulator the sampled points are added to
+     * @return The batch inertia: the sum of the squared distances from each sampled point to its centroid
+     */
+    double accumulateMiniBatch(const PointMatrix& points, const CentroidMatrix& centroids, size_t batchSize, std::mt19937& rng, CentroidMatrix& batchSums);
+
+    /**
+     * @brief Decides when mini-batch k-means is done.
+     *
+     * The usual test, that no centroid moved more than the threshold, takes forever here: the learning rates shrink
+     * like 1 / iteration, so the centroids creep for a very long time without getting meaningfully better. Instead,
+     * this keeps an exponentially weighted average of the per-point batch inertia, and stops once it hasn't improved
+     * for PATIENCE batches in a row (the same rule scikit-learn uses).
+     */
+    class MiniBatchConvergence {
+    public:
+        static constexpr size_t PATIENCE = 10;
+        static constexpr double SMOOTHING = 0.1;
+
+        /**
+         * @brief Everything update() remembers between batches, so a checkpoint can carry it over.
+         */
+        struct State {
+            double averageInertia = 0.0;
+            double bestAverageInertia = 0.0;
+            size_t batchesWithoutImprovement = 0;
+            bool started = false;
+        };
+
+        MiniBatchConvergence() = default;
+        explicit MiniBatchConvergence(const State& state) : m_State(state) {}
+
+        [[nodiscard]] inline const State& getState() const { return m_State; }
+
+        /**
+         * @brief Feeds in one batch.
+         * @param batchInertia The (global) inertia of the batch
+         * @param batchCount The (global) number of points in the batch
+         * @return Whether the run should stop
+         */
+        bool update(double batchInertia, double batchCount);
+
+    private:
+        State m_State;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_MINIBATCH_HPP
@@ -0,0 +1,95 @@
+//
+// Created by Matthew Krueger on 11/2/25.
+//
+
+#ifndef KMEANS_MPI_PARTITION_HPP
+#define KMEANS_MPI_PARTITION_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+namespace kmeans {
+
+    /**
+     * @brief A contiguous block of rows owned by one rank.
+     */
+    struct RowPartition {
+        size_t begin;
+        size_t count;
+    };
+
+    /**
+     * @brief Splits numRows rows into numParts contiguous blocks, as evenly as possible, and gets block part.
+     *
+     * The first numRows % numParts blocks get one extra row. Every rank can call this for any part and get the same
+     * answer, so nobody has to be told where their rows are.
+     * @param numRows The total number of rows
+     * @param numParts The number of blocks (ranks)
+     * @param part Which block to get
+     * @return The first row and the number of rows of that block
+     */
+    inline RowPartition partitionRows(const size_t numRows, const size_t numParts, const size_t part) {
+        const size_t baseCount = numRows / numParts;
+        const size_t remainder = numRows % numParts;
+        const size_t begin = part * baseCount + ((part < remainder) ? part : remainder);
+        return {begin, baseCount + ((part < remainder) ? 1 : 0)};
+    }
+
+    /**
+     * @brief The inverse of partitionRows(): which block a row ends up in.
+     * @param numRows The total number of rows
+     * @param numParts The number of blocks (ranks)
+     * @param row The row, less than numRows
+     * @return The block that partitionRows() puts row in
+     */
+    inline size_t partitionOfRow(const size_t numRows, const size_t numParts, const size_t row) {
+        const size_t baseCount = numRows / numParts;
+        const size_t remainder = numRows % numParts;
+        const size_t largeRows = remainder * (baseCount + 1);
+        return (row < largeRows) ? row / (baseCount + 1) : remainder + (row - largeRows) / baseCount;
+    }
+
+    /**
+     * @brief Splits numRows rows into contiguous blocks sized in proportion to weights, e.g. to how fast each rank is.
+     *
+     * Every block gets the whole part of its share, and the rows that are left go one each to the blocks with the
+     * largest fractional parts (the lower index first on a tie). The blocks stay in order, so block i still follows block
+     * i - 1, and every rank computing this from the same weights gets the same answer.
+     * @param numRows The total number of rows
+     * @param weights One non-negative weight per block, not all zero
+     * @return The first row and the number of rows of every block
+     */
+    inline std::vector<RowPartition> partitionRowsProportionally(const size_t numRows, const std::vector<double>& weights) {
+        const double totalWeight = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+        std::vector<size_t> counts(weights.size());
+        std::vector<double> remainders(weights.size());
+        size_t assigned = 0;
+        for (size_t part = 0; part < weights.size(); ++part) {
+            const double share = static_cast<double>(numRows) * weights[part] / totalWeight;
+            counts[part] = std::min(static_cast<size_t>(share), numRows - assigned);
+            remainders[part] = share - static_cast<double>(counts[part]);
+            assigned += counts[part];
+        }
+
+        std::vector<size_t> order(weights.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, [&remainders](const size_t lhs, const size_t rhs) { return remainders[lhs] > remainders[rhs]; });
+        for (size_t index = 0; assigned < numRows; index = (index + 1) % order.size(), ++assigned) {
+            ++counts[order[index]];
+        }
+
+        std::vector<RowPartition> partitions(weights.size());
+        size_t begin = 0;
+        for (size_t part = 0; part < weights.size(); ++part) {
+            partitions[part] = {begin, counts[part]};
+            begin += counts[part];
+        }
+        return partitions;
+    }
+
+} // kmeans
+
+#endif //KMEANS_MPI_PARTITION_HPP
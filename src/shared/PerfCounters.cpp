@@ -0,0 +1,122 @@
+//
+// Created by Matthew Krueger on 11/9/25.
+//
+
+#include "PerfCounters.hpp"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace instrumentation {
+
+    bool counterDifference(const CounterReading &start, const CounterReading &end, CounterSample &delta) {
+        const uint64_t enabled = end.timeEnabled - start.timeEnabled;
+        const uint64_t running = end.timeRunning - start.timeRunning;
+        if (running == 0) {
+            return false; // multiplexed out the whole time, so the counts didn't move, and zero would be a lie
+        }
+
+        delta = end.counts;
+        delta -= start.counts;
+        if (running < enabled) {
+            const double scale = static_cast<double>(enabled) / static_cast<double>(running);
+            for (uint64_t &value : delta.values) {
+                value = static_cast<uint64_t>(static_cast<double>(value) * scale + 0.5);
+            }
+        }
+        return true;
+    }
+
+#ifdef __linux__
+    namespace {
+
+        struct CounterEvent {
+            uint32_t type;
+            uint64_t config;
+        };
+
+        // in PERF_COUNTER_NAMES order
+        constexpr std::array<CounterEvent, NUM_PERF_COUNTERS> COUNTER_EVENTS = {{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        }};
+
+        int openCounter(const CounterEvent &event, const int groupDescriptor) {
+            perf_event_attr attributes{};
+            attributes.size = sizeof(attributes);
+            attributes.type = event.type;
+            attributes.config = event.config;
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+
+            // this thread (pid 0), on whatever cpu it runs on (-1)
+            return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, groupDescriptor, 0));
+        }
+
+    }
+
+    PerfCounterGroup::PerfCounterGroup() {
+        for (size_t counter = 0; counter < NUM_PERF_COUNTERS; ++counter) {
+            // the first counter that opens leads the group, and the rest join it
+            const int descriptor = openCounter(COUNTER_EVENTS[counter], m_LeaderDescriptor);
+            if (descriptor < 0) {
+                if (m_Error.empty()) {
+                    m_Error = std::string("could not open ") + PERF_COUNTER_NAMES[counter] + ": " + std::strerror(errno);
+                }
+                continue;
+            }
+
+            if (m_LeaderDescriptor < 0) {
+                m_LeaderDescriptor = descriptor;
+            }
+            m_Descriptors.push_back(descriptor);
+            m_CounterOfMember.push_back(counter);
+            m_AvailableMask |= 1u << counter;
+        }
+    }
+
+    PerfCounterGroup::~PerfCounterGroup() {
+        for (const int descriptor : m_Descriptors) {
+            close(descriptor);
+        }
+    }
+
+    bool PerfCounterGroup::read(CounterReading &reading) const {
+        if (m_LeaderDescriptor < 0) {
+            return false;
+        }
+
+        // the number of members, the time enabled, the time running, then each member's count, in the order they joined
+        uint64_t buffer[3 + NUM_PERF_COUNTERS];
+        const ssize_t bytes = ::read(m_LeaderDescriptor, buffer, sizeof(buffer));
+        const size_t numMembers = m_CounterOfMember.size();
+        if (bytes != static_cast<ssize_t>((3 + numMembers) * sizeof(uint64_t)) || buffer[0] != numMembers) {
+            return false;
+        }
+        reading.timeEnabled = buffer[1];
+        reading.timeRunning = buffer[2];
+        for (size_t member = 0; member < numMembers; ++member) {
+            reading.counts.values[m_CounterOfMember[member]] = buffer[3 + member];
+        }
+        return true;
+    }
+#else
+    PerfCounterGroup::PerfCounterGroup() : m_Error("hardware counters are only supported on Linux") {}
+
+    PerfCounterGroup::~PerfCounterGroup() = default;
+
+    bool PerfCounterGroup::read(CounterReading &) const {
+        return false;
+    }
+#endif
+
+}
@@ -0,0 +1,100 @@
+//
+// Created by Matthew Krueger on 11/9/25.
+//
+
+#ifndef KMEANS_MPI_PERFCOUNTERS_HPP
+#define KMEANS_MPI_PERFCOUNTERS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace instrumentation {
+
+    /// The hardware counters the profiler can read for every scope, in the order they are stored
+    inline constexpr size_t NUM_PERF_COUNTERS = 5;
+    inline constexpr std::array<const char*, NUM_PERF_COUNTERS> PERF_COUNTER_NAMES = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+    };
+    inline constexpr size_t PERF_COUNTER_CYCLES = 0;
+    inline constexpr size_t PERF_COUNTER_INSTRUCTIONS = 1;
+
+    /**
+     * @brief One reading of every counter, or the difference between two. Counters that couldn't be opened stay zero.
+     */
+    struct CounterSample {
+        std::array<uint64_t, NUM_PERF_COUNTERS> values{};
+
+        inline CounterSample& operator-=(const CounterSample& other) {
+            for (size_t counter = 0; counter < NUM_PERF_COUNTERS; ++counter) {
+                values[counter] -= other.values[counter];
+            }
+            return *this;
+        }
+    };
+
+    /**
+     * @brief What PerfCounterGroup::read() returns: the counts, and how long the group has been enabled and how long it
+     * was actually on the PMU, in nanoseconds. The two times only differ if the kernel had to multiplex the group.
+     */
+    struct CounterReading {
+        CounterSample counts;
+        uint64_t timeEnabled = 0;
+        uint64_t timeRunning = 0;
+    };
+
+    /**
+     * @brief The counts between two readings of the same group.
+     *
+     * If the group was only on the PMU for part of the time between them, the counts are scaled up by how long it was
+     * enabled over how long it ran, like perf stat does. If it wasn't on the PMU at all, there's nothing to scale.
+     * @param delta Where the counts go
+     * @return false if the group never ran between the two readings, so there are no counts
+     */
+    bool counterDifference(const CounterReading& start, const CounterReading& end, CounterSample& delta);
+
+    /**
+     * @brief The hardware counters of the calling thread, opened with perf_event_open as one group, so a single read()
+     * gets all of them at once.
+     *
+     * Counters are often not there: not Linux, no PMU in a VM or container, or perf_event_paranoid set too high. That
+     * is never an error. Whatever can't be opened is just left out of getAvailableMask(), and if nothing can be opened
+     * the group is empty and read() returns false. User space only, so it works with the usual paranoid level of 2.
+     *
+     * A group only counts the thread that created it, so every thread needs its own. If the PMU can't fit the whole
+     * group at once, the kernel multiplexes it, which the enabled and running times in every CounterReading show.
+     */
+    class PerfCounterGroup {
+    public:
+        PerfCounterGroup();
+        PerfCounterGroup(const PerfCounterGroup&) = delete;
+        PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+        ~PerfCounterGroup();
+
+        /**
+         * @brief Reads every counter in the group, along with its enabled and running times.
+         * @param reading Where the counts go. Counters that aren't in the group are left as they are.
+         * @return false if the group is empty or the read failed
+         */
+        bool read(CounterReading& reading) const;
+
+        /// Bit i is set if counter i (see PERF_COUNTER_NAMES) is being counted
+        [[nodiscard]] inline uint32_t getAvailableMask() const { return m_AvailableMask; }
+
+        /// Why the first counter that couldn't be opened couldn't be, or empty if they all opened
+        [[nodiscard]] inline const std::string& getError() const { return m_Error; }
+
+    private:
+        int m_LeaderDescriptor = -1;
+        std::vector<int> m_Descriptors;
+        /// Which counter each member of the group is, in the order read() returns them
+        std::vector<size_t> m_CounterOfMember;
+        uint32_t m_AvailableMask = 0;
+        std::string m_Error;
+    };
+
+}
+
+#endif //KMEANS_MPI_PERFCOUNTERS_HPP
@@ -0,0 +1,82 @@
+//
+// Created by Matthew Krueger on 11/3/25.
+//
+
+#ifndef KMEANS_MPI_PHILOX_HPP
+#define KMEANS_MPI_PHILOX_HPP
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <utility>
+
+namespace kmeans {
+
+    /**
+     * @brief The Philox4x32-10 counter-based random number generator (Salmon et al., 2011).
+     *
+     * Unlike std::mt19937, there is no state to advance: the output is a pure function of a 128-bit counter and a
+     * 64-bit key. So the random numbers for point i can be generated directly from i, on whichever rank owns point i,
+     * without generating points 0 through i - 1 first. That is what lets every rank generate just its own shard, and
+     * still get exactly the same dataset as any other rank count would.
+     */
+    class Philox4x32 {
+    public:
+        using Counter = std::array<uint32_t, 4>;
+        using Key = std::array<uint32_t, 2>;
+
+        /**
+         * @brief Scrambles a counter with a key. Ten rounds, which passes BigCrush.
+         */
+        static constexpr Counter generate(Counter counter, Key key) {
+            for (int round = 0; round < ROUNDS; ++round) {
+                const uint64_t product0 = static_cast<uint64_t>(MULTIPLIER_0) * counter[0];
+                const uint64_t product1 = static_cast<uint64_t>(MULTIPLIER_1) * counter[2];
+                counter = {
+                    static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                    static_cast<uint32_t>(product1),
+                    static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                    static_cast<uint32_t>(product0)
+                };
+                key[0] += WEYL_0;
+                key[1] += WEYL_1;
+            }
+            return counter;
+        }
+
+        /**
+         * @brief Turns two 32-bit words into a double uniform on the open interval (0, 1), with 53 bits of randomness.
+         */
+        static constexpr double toUniform(const uint32_t high, const uint32_t low) {
+            const uint64_t bits = (static_cast<uint64_t>(high >> 5) << 26) | (low >> 6);
+            return (static_cast<double>(bits) + 0.5) * 0x1.0p-53;
+        }
+
+        /**
+         * @brief Gets two independent standard normal samples for a (key, index, block) triple, with Box-Muller.
+         * @param seed The key, e.g. the dataset seed
+         * @param index The first counter word, e.g. the global point index
+         * @param block The second counter word, e.g. which pair of dimensions
+         */
+        static std::pair<double, double> standardNormalPair(const uint64_t seed, const uint64_t index, const uint64_t block) {
+            const Counter words = generate(
+                {static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32), static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32)},
+                {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)});
+
+            const double radius = std::sqrt(-2.0 * std::log(toUniform(words[0], words[1])));
+            const double angle = 2.0 * std::numbers::pi * toUniform(words[2], words[3]);
+            return {radius * std::cos(angle), radius * std::sin(angle)};
+        }
+
+    private:
+        static constexpr int ROUNDS = 10;
+        static constexpr uint32_t MULTIPLIER_0 = 0xD2511F53;
+        static constexpr uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+        static constexpr uint32_t WEYL_0 = 0x9E3779B9;
+        static constexpr uint32_t WEYL_1 = 0xBB67AE85;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_PHILOX_HPP
@@ -10,6 +10,7 @@
 #include <cmath>
 #include <ranges>
 
+#include "AssignmentKernel.hpp"
 #include "Instrumentation.hpp"
 
 namespace kmeans {
@@ -24,27 +25,8 @@ namespace kmeans {
                 std::to_string(other.m_Data.size()) + " dimensions.");
         }
 
-        // Lambda function to calculate the squared difference between two doubles.
-        auto squaredifference = [](double first, double second) -> double {
-            return std::pow(first - second, 2);
-        };
-
-        // Calculate the sum of squared differences using std::transform_reduce.
-        // m_Data.begin(), m_Data.end(): The range of elements from the current Point.
-        // other.m_Data.begin(): The starting iterator for the other Point's data.
-        // 0.0: The initial value for the sum.
-        // std::plus<double>(): The binary operation to combine the results of the transform.
-        // [squaredifference](auto first, auto second){ ... }: The transform operation, applying squaredifference to corresponding elements.
-        double totalSum = std::transform_reduce(
-            m_Data.begin(),
-            m_Data.end(),
-            other.m_Data.begin(),
-            0.0,
-            std::plus<>(),
-            squaredifference
-        );
-
-        return std::sqrt(totalSum);
+        // the squared distance comes from the same kernel the solvers use, we just take the root of it
+        return std::sqrt(kernel::squaredEuclideanDistance(m_Data.data(), other.m_Data.data(), m_Data.size()));
     }
 
     Point::FlattenedPoints Point::flattenPoints(const std::vector<Point> &points) {
@@ -86,6 +68,20 @@ namespace kmeans {
         };
     }
 
+    Point::FlattenedPoints Point::flattenPoints(const PointMatrix &points) {
+        PROFILE_FUNCTION();
+
+        if (points.empty()) {
+            throw std::invalid_argument("No points provided");
+        }
+
+        return Point::FlattenedPoints{
+            points.numDimensions(),
+            points.numPoints(),
+            std::vector<double>(points.data(), points.data() + points.numPoints() * points.numDimensions())
+        };
+    }
+
     std::vector<Point> Point::unflattenPoints(const FlattenedPoints &flattenedPoints) {
         PROFILE_FUNCTION();
 
@@ -216,25 +212,27 @@ namespace kmeans {
             return other.end();
         }
 
-        auto minIter = other.begin();
-        // set the min distance to max, that way we can track it.
-        double minDist = std::numeric_limits<double>::max();
-        bool foundValid = false;
+        // since this is the hot path, check the dimensions once up front (and only in debug builds),
+        // rather than letting calculateEuclideanDistance check them for every single centroid
+#ifndef NDEBUG
+        if (!std::ranges::all_of(other, [this](const Point &point) { return point.m_Data.size() == m_Data.size(); })) {
+            throw std::invalid_argument("Dimensions mismatch between the point and the centroids");
+        }
+#endif
 
         // iterate through the other vector, and find the closest point to this one.
         // this was one function that should not be functional, for unknown reasons
+        // Comparing squared distances picks the same winner as comparing distances, so there is no sqrt in here.
+        auto minIter = other.begin();
+        double minDist = std::numeric_limits<double>::max();
         for (auto it = other.begin(); it != other.end(); ++it) {
-            // if and only if the value is less than minDist, and if and only if it has a value
-            if (auto dist = calculateEuclideanDistance(*it); dist < minDist) {
+            if (const double dist = kernel::squaredEuclideanDistance(m_Data.data(), it->m_Data.data(), m_Data.size()); dist < minDist) {
                 minDist = dist;
                 minIter = it;
-                foundValid = true;
             }
-
         }
 
-        // return what we found, if none, the end iterator
-        return foundValid ? minIter : other.end();
+        return minIter;
     }
 
     
@@ -11,6 +11,8 @@
 #include <iostream>
 #include <boost/serialization/access.hpp>
 
+#include "PointMatrix.hpp"
+
 namespace kmeans{
     class Point{
     public:
@@ -35,6 +37,13 @@ namespace kmeans{
 
         explicit Point(std::vector<double> data, size_t count = 1) noexcept: m_Data(std::move(data)), m_Count(count) {}
 
+        /**
+         * @brief Creates an owning copy of a row of a PointMatrix.
+         * @param view The row to copy
+         * @param count The count to give the point
+         */
+        explicit Point(const PointView view, size_t count = 1) : m_Data(view.begin(), view.end()), m_Count(count) {}
+
         /**
          * @brief Copy constructor.
          * @param other The Point object to copy from.
@@ -122,6 +131,13 @@ namespace kmeans{
         double calculateEuclideanDistance(const Point& other) const;
 
         static FlattenedPoints flattenPoints(const std::vector<Point>& points);
+
+        /**
+         * @brief Flattens a PointMatrix. The matrix is already flat, so this is a single contiguous copy.
+         * @param points The matrix to flatten
+         * @return The flattened points
+         */
+        static FlattenedPoints flattenPoints(const PointMatrix& points);
         static std::vector<Point> unflattenPoints(const FlattenedPoints &flattenedPoints);
 
         Point& operator+=(const Point& other);
@@ -0,0 +1,244 @@
+//
+// Created by Matthew Krueger on 10/24/25.
+//
+
+#include "PointMatrix.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "AssignmentKernel.hpp"
+#include "Instrumentation.hpp"
+#include "Point.hpp"
+
+namespace kmeans {
+
+    PointMatrix::PointMatrix(const size_t numDimensions, AlignedDoubleVector data) : m_NumDimensions(numDimensions), m_Data(std::move(data)) {
+        if (m_NumDimensions == 0) {
+            if (!m_Data.empty()) {
+                throw std::invalid_argument("Cannot build a PointMatrix with data but no dimensions");
+            }
+            return;
+        }
+
+        if (m_Data.size() % m_NumDimensions != 0) {
+            throw std::invalid_argument(
+                "PointMatrix buffer size " + std::to_string(m_Data.size()) + " is not a multiple of " +
+                std::to_string(m_NumDimensions) + " dimensions");
+        }
+
+        m_NumPoints = m_Data.size() / m_NumDimensions;
+        m_Rows = m_Data.data();
+    }
+
+    PointMatrix::PointMatrix(const PointMatrix &other) :
+        m_NumPoints(other.m_NumPoints),
+        m_NumDimensions(other.m_NumDimensions),
+        m_Data(other.m_Data),
+        m_Keepalive(other.m_Keepalive) {
+        // a copy of an owning matrix owns a copy of the rows, a copy of a view views the same rows
+        m_Rows = ownsData() ? m_Data.data() : other.m_Rows;
+    }
+
+    PointMatrix::PointMatrix(PointMatrix &&other) noexcept :
+        m_NumPoints(std::exchange(other.m_NumPoints, 0)),
+        m_NumDimensions(std::exchange(other.m_NumDimensions, 0)),
+        m_Data(std::move(other.m_Data)),
+        m_Rows(std::exchange(other.m_Rows, nullptr)),
+        m_Keepalive(std::move(other.m_Keepalive)) {
+        // moving a vector keeps its allocation, so m_Rows is still right either way
+    }
+
+    PointMatrix &PointMatrix::operator=(const PointMatrix &other) {
+        if (this != &other) {
+            m_NumPoints = other.m_NumPoints;
+            m_NumDimensions = other.m_NumDimensions;
+            m_Data = other.m_Data;
+            m_Keepalive = other.m_Keepalive;
+            m_Rows = ownsData() ? m_Data.data() : other.m_Rows;
+        }
+        return *this;
+    }
+
+    PointMatrix &PointMatrix::operator=(PointMatrix &&other) noexcept {
+        if (this != &other) {
+            m_NumPoints = std::exchange(other.m_NumPoints, 0);
+            m_NumDimensions = std::exchange(other.m_NumDimensions, 0);
+            m_Data = std::move(other.m_Data);
+            m_Rows = std::exchange(other.m_Rows, nullptr);
+            m_Keepalive = std::move(other.m_Keepalive);
+        }
+        return *this;
+    }
+
+    PointMatrix PointMatrix::view(double *rows, const size_t numPoints, const size_t numDimensions, std::shared_ptr<void> keepalive) {
+        if (keepalive == nullptr) {
+            throw std::invalid_argument("A PointMatrix view needs something to keep its memory alive");
+        }
+
+        PointMatrix result;
+        result.m_NumPoints = numPoints;
+        result.m_NumDimensions = numDimensions;
+        result.m_Rows = rows;
+        result.m_Keepalive = std::move(keepalive);
+        return result;
+    }
+
+    PointMatrix PointMatrix::fromPoints(const std::vector<Point> &points) {
+        PROFILE_FUNCTION();
+
+        if (points.empty()) {
+            return {};
+        }
+
+        const size_t numDimensions = points[0].numDimensions();
+        PointMatrix result(points.size(), numDimensions);
+
+        // copy each point into its row. We check as we go rather than in a separate pass since this touches every point anyway.
+        for (size_t index = 0; index < points.size(); ++index) {
+            if (points[index].numDimensions() != numDimensions) {
+                throw std::invalid_argument("All points must have the same number of dimensions");
+            }
+            std::ranges::copy(points[index], result.row(index));
+        }
+
+        return result;
+    }
+
+    std::vector<Point> PointMatrix::toPoints() const {
+        PROFILE_FUNCTION();
+
+        std::vector<Point> result;
+        result.reserve(m_NumPoints);
+        for (size_t index = 0; index < m_NumPoints; ++index) {
+            result.emplace_back(std::vector<double>(row(index), row(index) + m_NumDimensions));
+        }
+        return result;
+    }
+
+    void PointMatrix::reserve(const size_t numPoints) {
+        if (!ownsData()) {
+            throw std::invalid_argument("Cannot grow a PointMatrix that views memory it doesn't own");
+        }
+        m_Data.reserve(numPoints * m_NumDimensions);
+        m_Rows = m_Data.data();
+    }
+
+    void PointMatrix::appendRow(const std::span<const double> point) {
+        if (!ownsData()) {
+            throw std::invalid_argument("Cannot grow a PointMatrix that views memory it doesn't own");
+        }
+
+        if (m_NumPoints == 0 && m_NumDimensions == 0) {
+            m_NumDimensions = point.size();
+        }
+
+        if (point.size() != m_NumDimensions) {
+            throw std::invalid_argument(
+                "Dimensions mismatch. Matrix has " + std::to_string(m_NumDimensions) + " dimensions, row has " +
+                std::to_string(point.size()) + " dimensions.");
+        }
+
+        m_Data.insert(m_Data.end(), point.begin(), point.end());
+        m_Rows = m_Data.data();
+        ++m_NumPoints;
+    }
+
+    CentroidMatrix CentroidMatrix::fromPoints(const std::vector<Point> &points) {
+        PROFILE_FUNCTION();
+
+        if (points.empty()) {
+            return {};
+        }
+
+        const size_t numDimensions = points[0].numDimensions();
+        CentroidMatrix result(points.size(), numDimensions);
+
+        for (size_t index = 0; index < points.size(); ++index) {
+            if (points[index].numDimensions() != numDimensions) {
+                throw std::invalid_argument("All centroids must have the same number of dimensions");
+            }
+            std::ranges::copy(points[index], result.row(index));
+            result.setCount(index, static_cast<double>(points[index].getCount()));
+        }
+
+        return result;
+    }
+
+    std::vector<Point> CentroidMatrix::toPoints() const {
+        PROFILE_FUNCTION();
+
+        std::vector<Point> result;
+        result.reserve(m_NumCentroids);
+        for (size_t index = 0; index < m_NumCentroids; ++index) {
+            result.emplace_back(std::vector<double>(row(index), row(index) + m_NumDimensions),
+                                static_cast<size_t>(getCount(index)));
+        }
+        return result;
+    }
+
+    void CentroidMatrix::zero() {
+        std::ranges::fill(m_Buffer, 0.0);
+    }
+
+    CentroidMatrix &CentroidMatrix::operator+=(const CentroidMatrix &other) {
+        #ifndef NDEBUG
+        if (m_Buffer.size() != other.m_Buffer.size()) {
+            throw std::invalid_argument("Cannot add centroid matrices of different shapes");
+        }
+        #endif
+
+        std::ranges::transform(m_Buffer, other.m_Buffer, m_Buffer.begin(), std::plus<>());
+        return *this;
+    }
+
+    void CentroidMatrix::finalize() {
+        PROFILE_FUNCTION();
+
+        for (size_t centroid = 0; centroid < m_NumCentroids; ++centroid) {
+            const double count = getCount(centroid);
+            if (count > 0.0) {
+                double* sum = row(centroid);
+                for (size_t dimension = 0; dimension < m_NumDimensions; ++dimension) {
+                    sum[dimension] /= count;
+                }
+                setCount(centroid, 1.0);
+            }
+            // If the count is 0, the sum is already {0,0,...}, which is correct for an empty cluster.
+        }
+    }
+
+    void CentroidMatrix::applyMiniBatch(const CentroidMatrix &batchSums) {
+        PROFILE_FUNCTION();
+
+        #ifndef NDEBUG
+        if (m_Buffer.size() != batchSums.m_Buffer.size()) {
+            throw std::invalid_argument("Cannot apply a mini-batch of a different shape");
+        }
+        #endif
+
+        for (size_t centroid = 0; centroid < m_NumCentroids; ++centroid) {
+            const double batchCount = batchSums.getCount(centroid);
+            if (batchCount == 0.0) {
+                continue; // nothing in this batch was classed here, so the centroid stays put
+            }
+
+            // c = (1 - eta) * c + eta * (batch sum / batch count), with eta = batch count / total count
+            const double totalCount = getCount(centroid) + batchCount;
+            const double learningRate = batchCount / totalCount;
+            double* coordinates = row(centroid);
+            const double* sum = batchSums.row(centroid);
+            for (size_t dimension = 0; dimension < m_NumDimensions; ++dimension) {
+                coordinates[dimension] += learningRate * (sum[dimension] / batchCount - coordinates[dimension]);
+            }
+            setCount(centroid, totalCount);
+        }
+    }
+
+    size_t CentroidMatrix::findClosestCentroid(const double *point) const {
+        return kernel::findNearestCentroid(point, coordinates(), m_NumCentroids, m_NumDimensions).index;
+    }
+
+} // kmeans
@@ -0,0 +1,312 @@
+//
+// Created by Matthew Krueger on 10/24/25.
+//
+
+#ifndef KMEANS_MPI_POINTMATRIX_HPP
+#define KMEANS_MPI_POINTMATRIX_HPP
+
+#include <cstddef>
+#include <memory>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <span>
+#include <vector>
+
+namespace kmeans {
+
+    class Point;
+
+    /**
+     * @brief A minimal allocator that hands out memory aligned to a cache line.
+     *
+     * Every row-major buffer in the solvers is allocated through this, so the first row of any matrix starts on a
+     * 64 byte boundary, which is what the vectorized kernels and the hardware prefetcher like to see.
+     * @tparam T The element type
+     * @tparam Alignment The alignment in bytes. Must be a power of two.
+     */
+    template<typename T, size_t Alignment = 64>
+    struct AlignedAllocator {
+        using value_type = T;
+
+        template<typename U>
+        struct rebind {
+            using other = AlignedAllocator<U, Alignment>;
+        };
+
+        AlignedAllocator() noexcept = default;
+        template<typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+        [[nodiscard]] T* allocate(size_t count) {
+            if (count > std::numeric_limits<size_t>::max() / sizeof(T)) {
+                throw std::bad_array_new_length();
+            }
+            return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+        }
+
+        void deallocate(T* pointer, size_t) noexcept {
+            ::operator delete(pointer, std::align_val_t(Alignment));
+        }
+
+        template<typename U>
+        bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    };
+
+    /**
+     * @brief A cache line aligned vector of doubles. This is the backing store of both PointMatrix and CentroidMatrix.
+     */
+    using AlignedDoubleVector = std::vector<double, AlignedAllocator<double>>;
+
+    /**
+     * @brief A lightweight, non-owning view of one row of a PointMatrix.
+     *
+     * This is what DataSet hands out instead of a Point, so reading a point costs nothing more than a pointer and a size.
+     * It exposes the same read-only surface as Point (size, operator[], iteration), so existing code that only reads
+     * coordinates keeps working. Convert to a Point explicitly when an owning copy is required.
+     */
+    class PointView {
+    public:
+        PointView() = default;
+        PointView(const double* data, size_t numDimensions) noexcept : m_Data(data), m_NumDimensions(numDimensions) {}
+
+        [[nodiscard]] inline const double* data() const { return m_Data; }
+        [[nodiscard]] inline size_t numDimensions() const { return m_NumDimensions; }
+        [[nodiscard]] inline size_t size() const { return m_NumDimensions; }
+        [[nodiscard]] inline bool empty() const { return m_NumDimensions == 0; }
+        [[nodiscard]] inline double operator[](const size_t index) const { return m_Data[index]; }
+
+        [[nodiscard]] inline const double* begin() const { return m_Data; }
+        [[nodiscard]] inline const double* end() const { return m_Data + m_NumDimensions; }
+
+        [[nodiscard]] inline std::span<const double> span() const { return {m_Data, m_NumDimensions}; }
+
+    private:
+        const double* m_Data = nullptr;
+        size_t m_NumDimensions = 0;
+    };
+
+    /**
+     * @brief A dense, row-major, cache line aligned matrix of points.
+     *
+     * Point i occupies the doubles [i * numDimensions, (i + 1) * numDimensions) of one contiguous buffer. This replaces
+     * std::vector<Point> for the dataset itself: there is exactly one allocation no matter how many points there are,
+     * the buffer can be handed to MPI as-is, and the assignment loop walks memory linearly.
+     *
+     * Usually the matrix owns its buffer. It can also view rows that live somewhere else, e.g. in a memory mapped file
+     * (see view()), in which case copies of it share those rows rather than duplicating them, and the memory is kept
+     * alive for as long as any of them still exists.
+     */
+    class PointMatrix {
+    public:
+        PointMatrix() = default;
+
+        /**
+         * @brief Creates a zero-filled matrix.
+         * @param numPoints The number of rows
+         * @param numDimensions The number of columns
+         */
+        PointMatrix(size_t numPoints, size_t numDimensions) : m_NumPoints(numPoints), m_NumDimensions(numDimensions), m_Data(numPoints * numDimensions, 0.0), m_Rows(m_Data.data()) {}
+
+        /**
+         * @brief Creates a matrix by taking ownership of an existing row-major buffer.
+         * @param numDimensions The number of columns. The buffer size must be a multiple of this.
+         * @param data The row-major coordinates
+         */
+        PointMatrix(size_t numDimensions, AlignedDoubleVector data);
+
+        PointMatrix(const PointMatrix& other);
+        PointMatrix(PointMatrix&& other) noexcept;
+        PointMatrix& operator=(const PointMatrix& other);
+        PointMatrix& operator=(PointMatrix&& other) noexcept;
+        ~PointMatrix() = default;
+
+        /**
+         * @brief Creates a matrix over rows it does not own, without copying them.
+         * @param rows The row-major coordinates, numPoints * numDimensions long. Should be cache line aligned, like an
+         * owned buffer, for the kernels to run at full speed.
+         * @param numPoints The number of rows
+         * @param numDimensions The number of columns
+         * @param keepalive Whatever keeps rows valid (e.g. the mapping). Held by this matrix and every copy of it.
+         * @return The view
+         */
+        static PointMatrix view(double* rows, size_t numPoints, size_t numDimensions, std::shared_ptr<void> keepalive);
+
+        /**
+         * @brief Whether the rows are this matrix's own buffer, rather than a view of someone else's memory.
+         */
+        [[nodiscard]] inline bool ownsData() const { return m_Keepalive == nullptr; }
+
+        /**
+         * @brief Packs a vector of Points into one contiguous matrix.
+         * @param points The points to copy. All must share the same dimensionality.
+         * @return The packed matrix
+         */
+        static PointMatrix fromPoints(const std::vector<Point>& points);
+
+        /**
+         * @brief Unpacks the matrix into owning Points. Only meant for the cold paths (results, debugging).
+         * @return One Point per row
+         */
+        [[nodiscard]] std::vector<Point> toPoints() const;
+
+        [[nodiscard]] inline size_t numPoints() const { return m_NumPoints; }
+        [[nodiscard]] inline size_t size() const { return m_NumPoints; }
+        [[nodiscard]] inline size_t numDimensions() const { return m_NumDimensions; }
+        [[nodiscard]] inline bool empty() const { return m_NumPoints == 0; }
+
+        [[nodiscard]] inline double* data() { return m_Rows; }
+        [[nodiscard]] inline const double* data() const { return m_Rows; }
+
+        [[nodiscard]] inline double* row(const size_t index) { return m_Rows + index * m_NumDimensions; }
+        [[nodiscard]] inline const double* row(const size_t index) const { return m_Rows + index * m_NumDimensions; }
+
+        [[nodiscard]] inline PointView operator[](const size_t index) const { return {row(index), m_NumDimensions}; }
+
+        /**
+         * @brief Reserves room for a number of rows. The dimensionality must already be known.
+         * @throws std::invalid_argument if the matrix is a view
+         */
+        void reserve(size_t numPoints);
+
+        /**
+         * @brief Appends a row to the end of the matrix.
+         *
+         * If the matrix is empty and has no dimensionality yet, the row defines it.
+         * @param point The coordinates to append
+         * @throws std::invalid_argument if the dimensions don't match, or the matrix is a view
+         */
+        void appendRow(std::span<const double> point);
+
+    private:
+        size_t m_NumPoints = 0;
+        size_t m_NumDimensions = 0;
+        /// The owned buffer. Empty for a view.
+        AlignedDoubleVector m_Data;
+        /// The first row: m_Data.data() when we own the rows, or the viewed memory when we don't
+        double* m_Rows = nullptr;
+        /// Keeps viewed memory alive. Null when we own the rows.
+        std::shared_ptr<void> m_Keepalive;
+    };
+
+    /**
+     * @brief The centroid counterpart to PointMatrix: k rows of coordinates plus a count per row.
+     *
+     * During an iteration the rows hold running sums and the counts hold the number of points that went into them;
+     * after finalize() the rows hold the actual centroid coordinates.
+     *
+     * The coordinates and the counts live in ONE buffer, laid out as [k * d coordinates][k counts], with the counts
+     * kept as doubles. That way the whole accumulator is a single homogeneous block that can be summed element-wise
+     * (by a reduction, by another thread, by anything) with no packing step. Doubles count exactly up to 2^53, which
+     * is far beyond any dataset we will see.
+     */
+    class CentroidMatrix {
+    public:
+        CentroidMatrix() = default;
+
+        /**
+         * @brief Creates a zeroed accumulator.
+         * @param numCentroids The number of centroids (k)
+         * @param numDimensions The number of dimensions (d)
+         */
+        CentroidMatrix(size_t numCentroids, size_t numDimensions) : m_NumCentroids(numCentroids), m_NumDimensions(numDimensions), m_Buffer(numCentroids * (numDimensions + 1), 0.0) {}
+
+        CentroidMatrix(const CentroidMatrix& other) = default;
+        CentroidMatrix(CentroidMatrix&& other) noexcept = default;
+        CentroidMatrix& operator=(const CentroidMatrix& other) = default;
+        CentroidMatrix& operator=(CentroidMatrix&& other) noexcept = default;
+        ~CentroidMatrix() = default;
+
+        /**
+         * @brief Packs centroids, including their counts, into a matrix.
+         */
+        static CentroidMatrix fromPoints(const std::vector<Point>& points);
+
+        /**
+         * @brief Unpacks the centroids, including their counts, into Points.
+         */
+        [[nodiscard]] std::vector<Point> toPoints() const;
+
+        [[nodiscard]] inline size_t numCentroids() const { return m_NumCentroids; }
+        [[nodiscard]] inline size_t size() const { return m_NumCentroids; }
+        [[nodiscard]] inline size_t numDimensions() const { return m_NumDimensions; }
+        [[nodiscard]] inline bool empty() const { return m_NumCentroids == 0; }
+
+        /**
+         * @brief The k * d row-major coordinate block.
+         */
+        [[nodiscard]] inline double* coordinates() { return m_Buffer.data(); }
+        [[nodiscard]] inline const double* coordinates() const { return m_Buffer.data(); }
+
+        [[nodiscard]] inline double* row(const size_t index) { return m_Buffer.data() + index * m_NumDimensions; }
+        [[nodiscard]] inline const double* row(const size_t index) const { return m_Buffer.data() + index * m_NumDimensions; }
+        [[nodiscard]] inline PointView operator[](const size_t index) const { return {row(index), m_NumDimensions}; }
+
+        [[nodiscard]] inline double getCount(const size_t index) const { return m_Buffer[m_NumCentroids * m_NumDimensions + index]; }
+        inline void setCount(const size_t index, const double count) { m_Buffer[m_NumCentroids * m_NumDimensions + index] = count; }
+
+        /**
+         * @brief The whole [coordinates][counts] block, for element-wise reductions.
+         */
+        [[nodiscard]] inline double* buffer() { return m_Buffer.data(); }
+        [[nodiscard]] inline const double* buffer() const { return m_Buffer.data(); }
+        [[nodiscard]] inline size_t bufferSize() const { return m_Buffer.size(); }
+
+        /**
+         * @brief Resets every sum and count to zero without reallocating.
+         */
+        void zero();
+
+        /**
+         * @brief Adds a point to the running sum of a centroid and bumps its count.
+         * @param centroidIndex The centroid the point was classed to
+         * @param point The point's coordinates, numDimensions() long
+         */
+        inline void accumulate(const size_t centroidIndex, const double* point) {
+            double* sum = row(centroidIndex);
+            for (size_t dimension = 0; dimension < m_NumDimensions; ++dimension) {
+                sum[dimension] += point[dimension];
+            }
+            m_Buffer[m_NumCentroids * m_NumDimensions + centroidIndex] += 1.0;
+        }
+
+        /**
+         * @brief Element-wise adds another accumulator (sums AND counts) into this one.
+         */
+        CentroidMatrix& operator+=(const CentroidMatrix& other);
+
+        /**
+         * @brief Turns the running sums into averages.
+         *
+         * Each row with a non-zero count is divided by its count, and that count is then reset to one.
+         * A row with a count of zero is an empty cluster and its sum, {0,0,...}, is left alone.
+         */
+        void finalize();
+
+        /**
+         * @brief Moves the centroids toward a mini-batch, with a per-centroid learning rate (Sculley, 2010).
+         *
+         * Here the counts are NOT reset to one like finalize() does. Instead, each one is the running total of every
+         * point that has ever been classed to that centroid, and each centroid moves toward the mean of its batch
+         * points by batchCount / totalCount. So a centroid that has seen a lot of points barely moves anymore, which is
+         * what lets mini-batch settle down without ever looking at the whole dataset.
+         * @param batchSums The batch accumulator, with the sums and counts of just this batch
+         */
+        void applyMiniBatch(const CentroidMatrix& batchSums);
+
+        /**
+         * @brief Finds the centroid closest to a point.
+         * @param point The point's coordinates, numDimensions() long
+         * @return The index of the closest centroid. Ties go to the lowest index.
+         */
+        [[nodiscard]] size_t findClosestCentroid(const double* point) const;
+
+    private:
+        size_t m_NumCentroids = 0;
+        size_t m_NumDimensions = 0;
+        AlignedDoubleVector m_Buffer;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_POINTMATRIX_HPP
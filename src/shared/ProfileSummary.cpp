@@ -0,0 +1,186 @@
+//
+// Created by Matthew Krueger on 11/9/25.
+//
+
+#include "ProfileSummary.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "TraceFormat.hpp"
+
+namespace instrumentation {
+
+    ProfileMode parseProfileMode(const std::string &name) {
+        if (name == "trace") {
+            return ProfileMode::Trace;
+        }
+        if (name == "aggregate") {
+            return ProfileMode::Aggregate;
+        }
+        throw std::invalid_argument("Unknown profile mode: " + name);
+    }
+
+    const char* getProfileModeName(const ProfileMode mode) {
+        switch (mode) {
+            case ProfileMode::Trace: return "trace";
+            case ProfileMode::Aggregate: return "aggregate";
+        }
+        return "unknown";
+    }
+
+    ScopeStatistics &ScopeStatistics::operator+=(const ScopeStatistics &other) {
+        count += other.count;
+        total += other.total;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+            histogram[bucket] += other.histogram[bucket];
+        }
+        for (size_t counter = 0; counter < NUM_PERF_COUNTERS; ++counter) {
+            counters.values[counter] += other.counters.values[counter];
+        }
+        return *this;
+    }
+
+    int64_t ScopeStatistics::quantileUpperBound(const double quantile) const {
+        if (count == 0) {
+            return 0;
+        }
+
+        // the smallest bucket that has at least that fraction of the calls at or below it
+        const auto target = static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(count)));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+            seen += histogram[bucket];
+            if (seen >= target && seen > 0) {
+                return bucket == 0 ? 0 : std::min(max, (int64_t{1} << bucket) - 1);
+            }
+        }
+        return max;
+    }
+
+    void mergeScopeStatistics(std::vector<NamedScopeStatistics> &summary, const std::vector<std::string> &names, const ScopeStatistics *statistics, const size_t numStatistics) {
+        std::unordered_map<std::string, size_t> indexOf;
+        for (size_t index = 0; index < summary.size(); ++index) {
+            indexOf.emplace(summary[index].name, index);
+        }
+
+        for (size_t nameID = 0; nameID < numStatistics && nameID < names.size(); ++nameID) {
+            if (statistics[nameID].count == 0) {
+                continue; // interned, but never closed on this process
+            }
+
+            const auto [iterator, inserted] = indexOf.try_emplace(names[nameID], summary.size());
+            if (inserted) {
+                summary.push_back({names[nameID], {}});
+            }
+            summary[iterator->second].statistics += statistics[nameID];
+        }
+    }
+
+    void printScopeStatistics(std::ostream &out, std::vector<NamedScopeStatistics> summary, const int numProcesses, const uint32_t counterMask) {
+        std::ranges::sort(summary, [](const NamedScopeStatistics &a, const NamedScopeStatistics &b) {
+            return a.statistics.total > b.statistics.total;
+        });
+
+        // times are summed over every thread of every process, so with many threads they can add up to more than the run
+        out << "Profile summary, " << numProcesses << " processes, times in microseconds (p50 and p99 are upper bounds)" << std::endl;
+        out << std::setw(12) << "Calls" << std::setw(14) << "Total" << std::setw(12) << "Mean" << std::setw(12) << "Min"
+            << std::setw(12) << "p50" << std::setw(12) << "p99" << std::setw(12) << "Max";
+
+        // the counters go between the times and the name, per call, except for IPC, which is the one that says whether
+        // a scope is waiting on memory or not
+        const auto counted = [counterMask](const size_t counter) { return (counterMask & (1u << counter)) != 0; };
+        const bool withIPC = counted(PERF_COUNTER_CYCLES) && counted(PERF_COUNTER_INSTRUCTIONS);
+        if (withIPC) {
+            out << std::setw(8) << "IPC";
+        }
+        for (size_t counter = 0; counter < NUM_PERF_COUNTERS; ++counter) {
+            if (counted(counter)) {
+                out << std::setw(20) << (std::string(PERF_COUNTER_NAMES[counter]) + "/call");
+            }
+        }
+        out << "  Scope" << std::endl;
+
+        const auto microseconds = [](const double nanoseconds) { return nanoseconds / 1000.0; };
+        out << std::fixed << std::setprecision(3);
+        for (const auto &[name, statistics] : summary) {
+            out << std::setw(12) << statistics.count
+                << std::setw(14) << microseconds(static_cast<double>(statistics.total))
+                << std::setw(12) << microseconds(static_cast<double>(statistics.total) / static_cast<double>(statistics.count))
+                << std::setw(12) << microseconds(static_cast<double>(statistics.min))
+                << std::setw(12) << microseconds(static_cast<double>(statistics.quantileUpperBound(0.5)))
+                << std::setw(12) << microseconds(static_cast<double>(statistics.quantileUpperBound(0.99)))
+                << std::setw(12) << microseconds(static_cast<double>(statistics.max));
+            if (withIPC) {
+                const uint64_t cycles = statistics.counters.values[PERF_COUNTER_CYCLES];
+                out << std::setw(8) << std::setprecision(2) << (cycles == 0 ? 0.0 : static_cast<double>(statistics.counters.values[PERF_COUNTER_INSTRUCTIONS]) / static_cast<double>(cycles));
+            }
+            out << std::setprecision(1);
+            for (size_t counter = 0; counter < NUM_PERF_COUNTERS; ++counter) {
+                if (counted(counter)) {
+                    out << std::setw(20) << static_cast<double>(statistics.counters.values[counter]) / static_cast<double>(statistics.count);
+                }
+            }
+            out << std::setprecision(3) << "  " << name << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+
+    void writeScopeStatisticsJson(const std::filesystem::path &path, const std::vector<NamedScopeStatistics> &summary, const int numProcesses, const uint32_t counterMask) {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("Could not open " + path.string() + " for writing");
+        }
+
+        out << "{\n";
+        out << R"(  "processes": )" << numProcesses << ",\n";
+        out << R"(  "unit": "ns",)" << "\n";
+        out << R"(  "histogram": "bucket 0 is 0ns, bucket b is [2^(b-1), 2^b) ns, the last bucket is open ended",)" << "\n";
+        out << R"(  "scopes": [)";
+        for (size_t index = 0; index < summary.size(); ++index) {
+            const auto &[name, statistics] = summary[index];
+            out << (index == 0 ? "\n" : ",\n");
+            out << R"(    {"name": ")";
+            writeJsonEscaped(out, name);
+            out << R"(", "count": )" << statistics.count << R"(, "total": )" << statistics.total
+                << R"(, "min": )" << statistics.min << R"(, "max": )" << statistics.max << R"(, "histogram": [)";
+
+            // leave off the empty buckets at the end, there are usually a lot of them
+            size_t usedBuckets = ScopeStatistics::HISTOGRAM_BUCKETS;
+            while (usedBuckets > 0 && statistics.histogram[usedBuckets - 1] == 0) {
+                --usedBuckets;
+            }
+            for (size_t bucket = 0; bucket < usedBuckets; ++bucket) {
+                out << (bucket == 0 ? "" : ", ") << statistics.histogram[bucket];
+            }
+            out << "]";
+
+            // the counter totals, for just the counters that were counted
+            if (counterMask != 0) {
+                out << R"(, "counters": {)";
+                bool firstCounter = true;
+                for (size_t counter = 0; counter < NUM_PERF_COUNTERS; ++counter) {
+                    if (counterMask & (1u << counter)) {
+                        out << (firstCounter ? "" : ", ") << '"' << PERF_COUNTER_NAMES[counter] << "\": " << statistics.counters.values[counter];
+                        firstCounter = false;
+                    }
+                }
+                out << '}';
+            }
+            out << '}';
+        }
+        out << "\n  ]\n}\n";
+
+        if (!out) {
+            throw std::runtime_error("Could not write " + path.string());
+        }
+    }
+
+}
@@ -0,0 +1,123 @@
+//
+// Created by Matthew Krueger on 11/9/25.
+//
+
+#ifndef KMEANS_MPI_PROFILESUMMARY_HPP
+#define KMEANS_MPI_PROFILESUMMARY_HPP
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "PerfCounters.hpp"
+
+namespace instrumentation {
+
+    /**
+     * @brief What the profiler keeps for every scope that closes.
+     */
+    enum class ProfileMode {
+        /// Every scope becomes a TraceRecord, and they all end up in the trace
+        Trace,
+        /// Nothing is kept per scope. Each scope site just counts, sums and buckets its durations (ScopeStatistics).
+        Aggregate
+    };
+
+    /**
+     * @brief Parses a profile mode from its command line name.
+     * @param name "trace" or "aggregate"
+     * @throws std::invalid_argument if the name is not recognized
+     */
+    ProfileMode parseProfileMode(const std::string& name);
+
+    /**
+     * @brief Gets the command line name of a profile mode.
+     */
+    const char* getProfileModeName(ProfileMode mode);
+
+    /**
+     * @brief Everything the aggregating profiler knows about one scope site: how often it ran, and how long it took.
+     *
+     * The histogram is log2 bucketed on nanoseconds. Bucket 0 holds durations of 0ns, and bucket b > 0 holds durations
+     * in [2^(b - 1), 2^b) ns, with the last bucket taking everything longer. With hardware counters on, it also sums
+     * every counter over every call. It's plain data, so it can be sent and summed as is.
+     */
+    struct ScopeStatistics {
+        static constexpr size_t HISTOGRAM_BUCKETS = 48;
+
+        uint64_t count = 0;
+        int64_t total = 0;
+        int64_t min = std::numeric_limits<int64_t>::max();
+        int64_t max = 0;
+        std::array<uint64_t, HISTOGRAM_BUCKETS> histogram{};
+        CounterSample counters;
+
+        static inline size_t bucketOf(const int64_t duration) {
+            if (duration <= 0) {
+                return 0;
+            }
+            const size_t bucket = std::bit_width(static_cast<uint64_t>(duration));
+            return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+        }
+
+        inline void add(const int64_t duration, const CounterSample* sample = nullptr) {
+            ++count;
+            total += duration;
+            min = duration < min ? duration : min;
+            max = duration > max ? duration : max;
+            ++histogram[bucketOf(duration)];
+            if (sample != nullptr) {
+                for (size_t counter = 0; counter < NUM_PERF_COUNTERS; ++counter) {
+                    counters.values[counter] += sample->values[counter];
+                }
+            }
+        }
+
+        ScopeStatistics& operator+=(const ScopeStatistics& other);
+
+        /**
+         * @brief An upper bound on the given quantile, from the histogram.
+         * @param quantile In [0, 1], e.g. 0.99
+         * @return The top of the bucket the quantile falls in, in nanoseconds, clamped to max
+         */
+        [[nodiscard]] int64_t quantileUpperBound(double quantile) const;
+    };
+    static_assert(std::is_trivially_copyable_v<ScopeStatistics>);
+
+    /**
+     * @brief One scope site, with its name, once the statistics of every thread and process have been combined.
+     */
+    struct NamedScopeStatistics {
+        std::string name;
+        ScopeStatistics statistics;
+    };
+
+    /**
+     * @brief Adds statistics from one process into a running summary, matching scopes up by name, since name IDs are
+     * only good within the process that handed them out.
+     */
+    void mergeScopeStatistics(std::vector<NamedScopeStatistics>& summary, const std::vector<std::string>& names, const ScopeStatistics* statistics, size_t numStatistics);
+
+    /**
+     * @brief Prints a summary as a table, the scopes taking the most time first.
+     * @param counterMask Which hardware counters were counted. Each one gets a per call column, plus instructions per
+     * cycle if both of those were counted.
+     */
+    void printScopeStatistics(std::ostream& out, std::vector<NamedScopeStatistics> summary, int numProcesses, uint32_t counterMask = 0);
+
+    /**
+     * @brief Writes a summary, histograms and counted hardware counters included, as JSON.
+     * @throws std::runtime_error if the file can't be written
+     */
+    void writeScopeStatisticsJson(const std::filesystem::path& path, const std::vector<NamedScopeStatistics>& summary, int numProcesses, uint32_t counterMask = 0);
+
+}
+
+#endif //KMEANS_MPI_PROFILESUMMARY_HPP
@@ -0,0 +1,98 @@
+//
+// Created by Matthew Krueger on 11/1/25.
+//
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace kmeans {
+
+    ThreadPool::ThreadPool(size_t numThreads) {
+        if (numThreads == 0) {
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        m_Workers.reserve(numThreads - 1);
+        for (size_t threadIndex = 1; threadIndex < numThreads; ++threadIndex) {
+            m_Workers.emplace_back([this, threadIndex] { workerLoop(threadIndex); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_WorkAvailable.notify_all();
+        // the jthreads join themselves
+    }
+
+    void ThreadPool::run(const std::function<void(size_t)> &task) {
+        if (m_Workers.empty()) {
+            task(0);
+            return;
+        }
+
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Task = &task;
+            m_Pending = m_Workers.size();
+            m_Exception = nullptr;
+            ++m_Generation;
+        }
+        m_WorkAvailable.notify_all();
+
+        // the caller is thread 0, and pulls its own weight
+        std::exception_ptr callerException;
+        try {
+            task(0);
+        } catch (...) {
+            callerException = std::current_exception();
+        }
+
+        std::unique_lock lock(m_Mutex);
+        m_WorkDone.wait(lock, [this] { return m_Pending == 0; });
+        m_Task = nullptr;
+
+        if (callerException) {
+            std::rethrow_exception(callerException);
+        }
+        if (m_Exception) {
+            std::rethrow_exception(m_Exception);
+        }
+    }
+
+    void ThreadPool::workerLoop(const size_t threadIndex) {
+        size_t seenGeneration = 0;
+        while (true) {
+            const std::function<void(size_t)>* task;
+            {
+                std::unique_lock lock(m_Mutex);
+                m_WorkAvailable.wait(lock, [&] { return m_Stopping || m_Generation != seenGeneration; });
+                if (m_Stopping) {
+                    return;
+                }
+                seenGeneration = m_Generation;
+                task = m_Task;
+            }
+
+            std::exception_ptr exception;
+            try {
+                (*task)(threadIndex);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+
+            {
+                std::lock_guard lock(m_Mutex);
+                if (exception && !m_Exception) {
+                    m_Exception = exception;
+                }
+                --m_Pending;
+            }
+            m_WorkDone.notify_one();
+        }
+    }
+
+} // kmeans
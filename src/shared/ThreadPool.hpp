@@ -0,0 +1,75 @@
+//
+// Created by Matthew Krueger on 11/1/25.
+//
+
+#ifndef KMEANS_MPI_THREADPOOL_HPP
+#define KMEANS_MPI_THREADPOOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kmeans {
+
+    /**
+     * @brief A fixed set of threads that run one task at a time, all together, fork-join style.
+     *
+     * This is all the solvers need: every iteration, every thread takes its own slice of the rows, and the caller
+     * waits for all of them. The calling thread is thread 0 and does its share of the work, so a pool of size one
+     * spawns nothing and costs nothing.
+     *
+     * Only the calling thread should ever touch MPI. The workers only ever run the task they are handed.
+     */
+    class ThreadPool {
+    public:
+        /**
+         * @brief Starts the pool.
+         * @param numThreads The total number of threads, INCLUDING the caller. Zero means one per hardware thread.
+         */
+        explicit ThreadPool(size_t numThreads);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+        ~ThreadPool();
+
+        [[nodiscard]] inline size_t size() const { return m_Workers.size() + 1; }
+
+        /**
+         * @brief Runs task(threadIndex) once on every thread, and waits until every one of them has returned.
+         * @param task The work. It is given the index of the thread running it, in [0, size())
+         * @throws Whatever the first failing task threw, after every thread has finished
+         */
+        void run(const std::function<void(size_t)>& task);
+
+        /**
+         * @brief Splits rows [0, numRows) into size() contiguous, near equal slices.
+         * @return The first row of slice threadIndex. Slice i is [sliceBegin(i), sliceBegin(i + 1)).
+         */
+        [[nodiscard]] inline size_t sliceBegin(const size_t threadIndex, const size_t numRows) const {
+            return numRows * threadIndex / size();
+        }
+
+    private:
+        void workerLoop(size_t threadIndex);
+
+        std::vector<std::jthread> m_Workers;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_WorkAvailable;
+        std::condition_variable m_WorkDone;
+        const std::function<void(size_t)>* m_Task = nullptr;
+        /// Bumped every run(), so a worker can tell a new task from the one it just finished
+        size_t m_Generation = 0;
+        size_t m_Pending = 0;
+        bool m_Stopping = false;
+        std::exception_ptr m_Exception;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_THREADPOOL_HPP
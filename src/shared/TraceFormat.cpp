@@ -0,0 +1,219 @@
+//
+// Created by Matthew Krueger on 11/9/25.
+//
+
+#include "TraceFormat.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace instrumentation {
+
+    TraceFormat parseTraceFormat(const std::string &name) {
+        if (name == "json") {
+            return TraceFormat::ChromeJson;
+        }
+        if (name == "binary") {
+            return TraceFormat::Binary;
+        }
+        throw std::invalid_argument("Unknown trace format: " + name);
+    }
+
+    const char* getTraceFormatName(const TraceFormat format) {
+        switch (format) {
+            case TraceFormat::ChromeJson: return "json";
+            case TraceFormat::Binary: return "binary";
+        }
+        return "unknown";
+    }
+
+    std::vector<char> packNames(const std::vector<std::string> &names) {
+        std::vector<char> packed;
+        for (const std::string &name : names) {
+            packed.insert(packed.end(), name.begin(), name.end());
+            packed.push_back('\0');
+        }
+        return packed;
+    }
+
+    std::vector<std::string> unpackNames(const char *packed, const size_t size) {
+        std::vector<std::string> names;
+        size_t offset = 0;
+        while (offset < size) {
+            const size_t length = strnlen(packed + offset, size - offset);
+            names.emplace_back(packed + offset, length);
+            offset += length + 1;
+        }
+        return names;
+    }
+
+    void writeTraceFileHeader(std::ostream &out) {
+        TraceFileHeader header{};
+        std::memcpy(header.magic, TraceFileHeader::MAGIC, sizeof(header.magic));
+        header.version = TraceFileHeader::VERSION;
+        header.byteOrderMark = TraceFileHeader::BYTE_ORDER_MARK;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void writeTraceChunk(std::ostream &out, const uint32_t processID, const std::vector<char> &packedNames, const size_t numNames, const TraceRecord *records, const size_t numRecords, const CounterSample *counters, const uint32_t counterMask) {
+        const uint32_t writtenMask = counters == nullptr ? 0 : counterMask;
+        const TraceChunkHeader header{processID, static_cast<uint32_t>(numNames), packedNames.size(), numRecords, writtenMask, 0};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(packedNames.data(), static_cast<std::streamsize>(packedNames.size()));
+        out.write(reinterpret_cast<const char*>(records), static_cast<std::streamsize>(numRecords * sizeof(TraceRecord)));
+        if (writtenMask != 0) {
+            out.write(reinterpret_cast<const char*>(counters), static_cast<std::streamsize>(numRecords * sizeof(CounterSample)));
+        }
+    }
+
+    namespace {
+
+        /// Chrome traces are in microseconds, but the records are in nanoseconds, so keep the rest as a fraction
+        void writeMicroseconds(std::ostream &out, const int64_t nanoseconds) {
+            const int64_t fraction = nanoseconds % 1000;
+            out << nanoseconds / 1000 << '.' << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + fraction / 10 % 10) << static_cast<char>('0' + fraction % 10);
+        }
+
+    }
+
+    void writeJsonEscaped(std::ostream &out, const std::string &text) {
+        static constexpr char HEX[] = "0123456789abcdef";
+        for (const char character : text) {
+            if (character == '"' || character == '\\') {
+                out << '\\' << character;
+            } else if (static_cast<unsigned char>(character) < 0x20) {
+                out << "\\u00" << HEX[character >> 4] << HEX[character & 0xF];
+            } else {
+                out << character;
+            }
+        }
+    }
+
+    void writeChromeTraceEvents(std::ostream &out, const uint32_t processID, const std::vector<std::string> &names, const TraceRecord *records, const size_t numRecords, bool &firstEvent, const CounterSample *counters, const uint32_t counterMask) {
+        static const std::string UNKNOWN_NAME = "(unknown)";
+        const bool withCounters = counters != nullptr && counterMask != 0;
+
+        // {"cycles":123,"instructions":456,...}, with just the counters that were counted
+        const auto writeCounterArgs = [&](const CounterSample &sample) {
+            out << '{';
+            bool firstCounter = true;
+            for (size_t counter = 0; counter < NUM_PERF_COUNTERS; ++counter) {
+                if (counterMask & (1u << counter)) {
+                    out << (firstCounter ? "" : ",") << '"' << PERF_COUNTER_NAMES[counter] << "\":" << sample.values[counter];
+                    firstCounter = false;
+                }
+            }
+            out << '}';
+        };
+
+        for (size_t index = 0; index < numRecords; ++index) {
+            const TraceRecord &record = records[index];
+            const std::string &name = record.nameID < names.size() ? names[record.nameID] : UNKNOWN_NAME;
+            if (!firstEvent) {
+                out << ",\n";
+            }
+            firstEvent = false;
+
+            out << R"({"cat":"function","dur":)";
+            writeMicroseconds(out, record.duration);
+            out << R"(,"name":")";
+            writeJsonEscaped(out, name);
+            out << R"(","ph":"X","pid":)" << processID << R"(,"tid":)" << record.threadID << R"(,"ts":)";
+            writeMicroseconds(out, record.start);
+            if (withCounters) {
+                out << R"(,"args":)";
+                writeCounterArgs(counters[index]);
+            }
+            out << '}';
+
+            if (withCounters) {
+                out << ",\n" << R"({"cat":"counters","name":")";
+                writeJsonEscaped(out, name);
+                out << R"(","ph":"C","pid":)" << processID << R"(,"tid":)" << record.threadID << R"(,"ts":)";
+                writeMicroseconds(out, record.start);
+                out << R"(,"args":)";
+                writeCounterArgs(counters[index]);
+                out << '}';
+            }
+        }
+    }
+
+    void readTraceFile(const std::filesystem::path &tracePath, const std::function<void(const TraceChunkHeader&, const std::vector<char>&, const std::vector<TraceRecord>&, const std::vector<CounterSample>&)> &onChunk) {
+        std::ifstream in(tracePath, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("Could not open " + tracePath.string());
+        }
+
+        TraceFileHeader header{};
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!in || std::memcmp(header.magic, TraceFileHeader::MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error(tracePath.string() + " is not a trace file");
+        }
+        if (header.byteOrderMark != TraceFileHeader::BYTE_ORDER_MARK) {
+            throw std::runtime_error(tracePath.string() + " was written on a machine with a different byte order");
+        }
+        if (header.version != TraceFileHeader::VERSION) {
+            throw std::runtime_error(tracePath.string() + " is trace format version " + std::to_string(header.version) + ", but only version " + std::to_string(TraceFileHeader::VERSION) + " is supported");
+        }
+
+        std::vector<char> packedNames;
+        std::vector<TraceRecord> records;
+        std::vector<CounterSample> counters;
+        TraceChunkHeader chunk{};
+        while (in.read(reinterpret_cast<char*>(&chunk), sizeof(chunk))) {
+            packedNames.resize(chunk.namesBytes);
+            records.resize(chunk.numRecords);
+            counters.resize(chunk.counterMask != 0 ? chunk.numRecords : 0);
+            in.read(packedNames.data(), static_cast<std::streamsize>(packedNames.size()));
+            in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TraceRecord)));
+            in.read(reinterpret_cast<char*>(counters.data()), static_cast<std::streamsize>(counters.size() * sizeof(CounterSample)));
+            if (!in) {
+                throw std::runtime_error(tracePath.string() + " ends in the middle of a chunk");
+            }
+            onChunk(chunk, packedNames, records, counters);
+        }
+    }
+
+    void convertTraceToChromeJson(const std::vector<std::filesystem::path> &tracePaths, const std::filesystem::path &jsonPath) {
+        std::ofstream out(jsonPath);
+        if (!out) {
+            throw std::runtime_error("Could not open " + jsonPath.string() + " for writing");
+        }
+        out << "[\n";
+
+        bool firstEvent = true;
+        for (const std::filesystem::path &tracePath : tracePaths) {
+            readTraceFile(tracePath, [&](const TraceChunkHeader &chunk, const std::vector<char> &packedNames, const std::vector<TraceRecord> &records, const std::vector<CounterSample> &counters) {
+                writeChromeTraceEvents(out, chunk.processID, unpackNames(packedNames.data(), packedNames.size()), records.data(), records.size(), firstEvent,
+                                       counters.empty() ? nullptr : counters.data(), chunk.counterMask);
+            });
+        }
+
+        out << "\n]";
+        if (!out) {
+            throw std::runtime_error("Could not write " + jsonPath.string());
+        }
+    }
+
+    void mergeTraceFiles(const std::vector<std::filesystem::path> &tracePaths, const std::filesystem::path &outputPath) {
+        std::ofstream out(outputPath, std::ios::binary);
+        if (!out) {
+            throw std::runtime_error("Could not open " + outputPath.string() + " for writing");
+        }
+        writeTraceFileHeader(out);
+
+        // every chunk carries its own process ID and name table, so the chunks can just be laid end to end
+        for (const std::filesystem::path &tracePath : tracePaths) {
+            readTraceFile(tracePath, [&](const TraceChunkHeader &chunk, const std::vector<char> &packedNames, const std::vector<TraceRecord> &records, const std::vector<CounterSample> &counters) {
+                writeTraceChunk(out, chunk.processID, packedNames, chunk.numNames, records.data(), records.size(),
+                                counters.empty() ? nullptr : counters.data(), chunk.counterMask);
+            });
+        }
+
+        if (!out) {
+            throw std::runtime_error("Could not write " + outputPath.string());
+        }
+    }
+
+}
@@ -0,0 +1,150 @@
+//
+// Created by Matthew Krueger on 11/9/25.
+//
+
+#ifndef KMEANS_MPI_TRACEFORMAT_HPP
+#define KMEANS_MPI_TRACEFORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "PerfCounters.hpp"
+
+namespace instrumentation {
+
+    /**
+     * @brief One finished scope, exactly as it is recorded. Nothing is formatted until the trace is written out.
+     *
+     * The name is an ID into the name table of the process that recorded it (see NameTable), and the process is
+     * implied by whichever chunk of the trace the record is in, so a record is just 24 bytes.
+     */
+    struct TraceRecord {
+        uint32_t nameID;
+        uint32_t threadID;
+        /// Nanoseconds, on the clock of the recording process
+        int64_t start;
+        /// Nanoseconds
+        int64_t duration;
+    };
+    static_assert(sizeof(TraceRecord) == 24, "TraceRecord is written to disk as is, so its layout is part of the format");
+
+    /**
+     * @brief What the profiler writes at the end of a session.
+     */
+    enum class TraceFormat {
+        /// A Chrome trace (chrome://tracing, Perfetto), formatted when the profiler flushes
+        ChromeJson,
+        /// The raw records and name tables, to be turned into a Chrome trace later with kmeans_trace_to_json
+        Binary
+    };
+
+    /**
+     * @brief Parses a trace format from its command line name.
+     * @param name "json" or "binary"
+     * @throws std::invalid_argument if the name is not recognized
+     */
+    TraceFormat parseTraceFormat(const std::string& name);
+
+    /**
+     * @brief Gets the command line name of a trace format.
+     */
+    const char* getTraceFormatName(TraceFormat format);
+
+    /**
+     * @brief The header at the very start of a binary trace file.
+     *
+     * The rest of the file is any number of chunks, back to back, each one a TraceChunkHeader, then the process's name
+     * table (numNames NUL terminated strings, namesBytes in total), then numRecords TraceRecords, then, if counterMask
+     * isn't zero, a CounterSample for every record, in the same order.
+     */
+    struct TraceFileHeader {
+        static constexpr char MAGIC[8] = {'K', 'M', 'T', 'R', 'A', 'C', 'E', '1'};
+        static constexpr uint32_t VERSION = 2;
+        static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+    };
+    static_assert(sizeof(TraceFileHeader) == 16);
+
+    struct TraceChunkHeader {
+        uint32_t processID;
+        uint32_t numNames;
+        uint64_t namesBytes;
+        uint64_t numRecords;
+        /// Which hardware counters were counted (bit i is PERF_COUNTER_NAMES[i]), or 0 if there are no CounterSamples
+        uint32_t counterMask;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(TraceChunkHeader) == 32);
+    static_assert(sizeof(CounterSample) == NUM_PERF_COUNTERS * sizeof(uint64_t));
+
+    /**
+     * @brief Packs a name table into NUL terminated strings, back to back, the way it is sent and stored.
+     */
+    std::vector<char> packNames(const std::vector<std::string>& names);
+
+    /**
+     * @brief The inverse of packNames().
+     */
+    std::vector<std::string> unpackNames(const char* packed, size_t size);
+
+    void writeTraceFileHeader(std::ostream& out);
+
+    /**
+     * @brief Writes one process's records, along with the names they refer to, as one chunk of a binary trace file.
+     * @param counters One sample per record, or null if no counters were read. Ignored if counterMask is 0.
+     * @param counterMask Which of the counters were actually counted
+     */
+    void writeTraceChunk(std::ostream& out, uint32_t processID, const std::vector<char>& packedNames, size_t numNames, const TraceRecord* records, size_t numRecords, const CounterSample* counters = nullptr, uint32_t counterMask = 0);
+
+    /**
+     * @brief Writes text as the inside of a JSON string, escaping quotes, backslashes and control characters.
+     */
+    void writeJsonEscaped(std::ostream& out, const std::string& text);
+
+    /**
+     * @brief Writes records as Chrome trace events, i.e. the comma separated body of the JSON array.
+     * @param out Where the events go
+     * @param processID The process the records came from
+     * @param names That process's name table
+     * @param records The records
+     * @param numRecords How many records there are
+     * @param firstEvent Whether nothing has been written to the array yet, so no comma goes before the first event.
+     * Updated, so it can be passed along from one call to the next.
+     * @param counters One sample per record, or null. Each counted scope also gets the counters as the args of its
+     * event, and a counter ("C") event of its own, so they show up as a track per scope name.
+     * @param counterMask Which of the counters were actually counted
+     */
+    void writeChromeTraceEvents(std::ostream& out, uint32_t processID, const std::vector<std::string>& names, const TraceRecord* records, size_t numRecords, bool& firstEvent, const CounterSample* counters = nullptr, uint32_t counterMask = 0);
+
+    /**
+     * @brief Reads a binary trace file, one chunk at a time.
+     * @param tracePath The file
+     * @param onChunk Called with every chunk's header, packed name table, records and counter samples (empty if the chunk
+     * has none), in the order they are in the file
+     * @throws std::runtime_error if the file can't be read, isn't a trace file, or is cut short
+     */
+    void readTraceFile(const std::filesystem::path& tracePath, const std::function<void(const TraceChunkHeader&, const std::vector<char>&, const std::vector<TraceRecord>&, const std::vector<CounterSample>&)>& onChunk);
+
+    /**
+     * @brief Turns one or more binary trace files (e.g. the shard of every rank) into a single Chrome trace.
+     * @throws std::runtime_error if a trace can't be read or isn't a trace file, or the output can't be written
+     */
+    void convertTraceToChromeJson(const std::vector<std::filesystem::path>& tracePaths, const std::filesystem::path& jsonPath);
+
+    /**
+     * @brief Concatenates the chunks of one or more binary trace files into a single binary trace file.
+     * @throws std::runtime_error if a trace can't be read or isn't a trace file, or the output can't be written
+     */
+    void mergeTraceFiles(const std::vector<std::filesystem::path>& tracePaths, const std::filesystem::path& outputPath);
+
+}
+
+#endif //KMEANS_MPI_TRACEFORMAT_HPP
@@ -12,6 +12,7 @@
 #include <unordered_set>
 
 #include "Point.hpp"
+#include "PointMatrix.hpp"
 
 namespace kmeans {
 
@@ -57,6 +58,27 @@ namespace kmeans {
 
     }
 
+    inline bool areCentroidsConverged(const CentroidMatrix& lhs, const CentroidMatrix& rhs, const double epsilon) {
+
+        // same test as above, but on the contiguous matrices. We compare squared distances against a squared epsilon
+        // so there is no sqrt per centroid.
+        const double epsilonSquared = epsilon * epsilon;
+        const size_t numDimensions = lhs.numDimensions();
+        return std::ranges::all_of(
+            std::ranges::views::iota(static_cast<size_t>(0), lhs.numCentroids()),
+            [&](const size_t centroid) {
+                const double* left = lhs.row(centroid);
+                const double* right = rhs.row(centroid);
+                double distance = 0.0;
+                for (size_t dimension = 0; dimension < numDimensions; ++dimension) {
+                    const double difference = left[dimension] - right[dimension];
+                    distance += difference * difference;
+                }
+                return distance < epsilonSquared;
+            });
+
+    }
+
     inline double getMaxCentroidDifference(const std::vector<Point>& lhs, const std::vector<Point>& rhs) {
 
         return 0.0;
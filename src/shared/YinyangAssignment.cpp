@@ -0,0 +1,253 @@
+//
+// Created by Matthew Krueger on 10/29/25.
+//
+
+#include "YinyangAssignment.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "AssignmentKernel.hpp"
+#include "Instrumentation.hpp"
+
+namespace kmeans {
+
+    void YinyangAssignmentEngine::formGroups(const CentroidMatrix &centroids) {
+        PROFILE_FUNCTION();
+
+        const size_t numCentroids = centroids.numCentroids();
+        const size_t numDimensions = centroids.numDimensions();
+        size_t groupCount = (m_RequestedGroupCount == 0) ? numCentroids / 10 : m_RequestedGroupCount;
+        groupCount = std::clamp<size_t>(groupCount, 1, std::max<size_t>(numCentroids, 1));
+
+        // seed the group centers with evenly spaced centroids. The centroids are already a random sample, so this is
+        // as good as any other choice, and it is deterministic, which matters since every rank has to agree.
+        CentroidMatrix groupCenters(groupCount, numDimensions);
+        for (size_t group = 0; group < groupCount; ++group) {
+            std::ranges::copy(centroids[group * numCentroids / groupCount], groupCenters.row(group));
+        }
+
+        m_CentroidGroup.assign(numCentroids, 0);
+        CentroidMatrix groupSums(groupCount, numDimensions);
+        for (size_t round = 0; round < GROUPING_ITERATIONS; ++round) {
+            groupSums.zero();
+            for (size_t centroid = 0; centroid < numCentroids; ++centroid) {
+                const auto nearest = kernel::findNearestCentroid(centroids.row(centroid), groupCenters.coordinates(), groupCount, numDimensions);
+                m_CentroidGroup[centroid] = static_cast<uint32_t>(nearest.index);
+                groupSums.accumulate(nearest.index, centroids.row(centroid));
+            }
+
+            // keep the old center for a group that lost all of its members, rather than collapsing it to the origin
+            for (size_t group = 0; group < groupCount; ++group) {
+                if (groupSums.getCount(group) == 0.0) {
+                    std::copy_n(groupCenters.row(group), numDimensions, groupSums.row(group));
+                    groupSums.setCount(group, 1.0);
+                }
+            }
+            groupSums.finalize();
+            std::swap(groupCenters, groupSums);
+        }
+
+        // collect the members, dropping any group that ended up empty, and renumber what is left
+        std::vector<std::vector<uint32_t>> members(groupCount);
+        for (size_t centroid = 0; centroid < numCentroids; ++centroid) {
+            members[m_CentroidGroup[centroid]].push_back(static_cast<uint32_t>(centroid));
+        }
+
+        m_GroupMembers.clear();
+        for (auto &group : members) {
+            if (!group.empty()) {
+                for (const uint32_t centroid : group) {
+                    m_CentroidGroup[centroid] = static_cast<uint32_t>(m_GroupMembers.size());
+                }
+                m_GroupMembers.push_back(std::move(group));
+            }
+        }
+    }
+
+    void YinyangAssignmentEngine::prepare(const PointMatrix &points, const CentroidMatrix &centroids) {
+        PROFILE_FUNCTION();
+
+        const size_t numCentroids = centroids.numCentroids();
+        const size_t numDimensions = centroids.numDimensions();
+
+        // if we have never seen these points (or these centroids), the bounds mean nothing, and we start over
+        if (m_PointsSource != points.data() || m_NumPoints != points.numPoints() || m_NumCentroids != numCentroids) {
+            m_NumPoints = points.numPoints();
+            m_NumCentroids = numCentroids;
+            m_PointsSource = points.data();
+
+            formGroups(centroids);
+
+            m_Labels.assign(m_NumPoints, 0);
+            m_UpperBounds.assign(m_NumPoints, 0.0);
+            m_GroupLowerBounds.assign(m_NumPoints * m_GroupMembers.size(), 0.0);
+            m_Drift.assign(m_NumCentroids, 0.0);
+            m_GroupDrift.assign(m_GroupMembers.size(), 0.0);
+            m_Initializing = true;
+        } else {
+            // measure how far each centroid moved, and the furthest any centroid in each group moved
+            m_Initializing = false;
+            std::ranges::fill(m_GroupDrift, 0.0);
+            for (size_t centroid = 0; centroid < numCentroids; ++centroid) {
+                const double drift = std::sqrt(kernel::squaredEuclideanDistance(
+                    m_LastCentroids.data() + centroid * numDimensions, centroids.row(centroid), numDimensions));
+                m_Drift[centroid] = drift;
+                m_GroupDrift[m_CentroidGroup[centroid]] = std::max(m_GroupDrift[m_CentroidGroup[centroid]], drift);
+            }
+        }
+
+        m_LastCentroids.assign(centroids.coordinates(), centroids.coordinates() + numCentroids * numDimensions);
+    }
+
+    void YinyangAssignmentEngine::initializeRows(const PointMatrix &points, const CentroidMatrix &centroids, const size_t begin, const size_t end, CentroidMatrix &sums) {
+        const size_t numDimensions = points.numDimensions();
+        const size_t groupCount = m_GroupMembers.size();
+        std::vector<double> distances(m_NumCentroids);
+
+        for (size_t index = begin; index < end; ++index) {
+            const double* point = points.row(index);
+
+            uint32_t label = 0;
+            for (size_t centroid = 0; centroid < m_NumCentroids; ++centroid) {
+                distances[centroid] = std::sqrt(kernel::squaredEuclideanDistance(point, centroids.row(centroid), numDimensions));
+                if (distances[centroid] < distances[label]) {
+                    label = static_cast<uint32_t>(centroid);
+                }
+            }
+
+            // each group's bound is its closest member, not counting the point's own centroid
+            double* lower = m_GroupLowerBounds.data() + index * groupCount;
+            for (size_t group = 0; group < groupCount; ++group) {
+                double closest = std::numeric_limits<double>::max();
+                for (const uint32_t centroid : m_GroupMembers[group]) {
+                    if (centroid != label) {
+                        closest = std::min(closest, distances[centroid]);
+                    }
+                }
+                lower[group] = closest;
+            }
+
+            m_Labels[index] = label;
+            m_UpperBounds[index] = distances[label];
+            sums.accumulate(label, point);
+        }
+
+        m_DistanceEvaluations.fetch_add((end - begin) * m_NumCentroids, std::memory_order_relaxed);
+    }
+
+    void YinyangAssignmentEngine::assign(const PointMatrix &points, const CentroidMatrix &centroids, const size_t begin, const size_t end, CentroidMatrix &sums) {
+        PROFILE_FUNCTION();
+
+        if (m_Initializing) {
+            initializeRows(points, centroids, begin, end, sums);
+            return;
+        }
+
+        const size_t numDimensions = points.numDimensions();
+        const size_t groupCount = m_GroupMembers.size();
+        uint64_t evaluations = 0;
+
+        // scratch space, reused for every point in the range
+        std::vector<double> previousLower(groupCount);
+        std::vector<double> groupClosest(groupCount);
+        std::vector<double> groupSecondClosest(groupCount);
+        std::vector<uint32_t> groupClosestIndex(groupCount);
+        std::vector<char> groupOpened(groupCount);
+
+        for (size_t index = begin; index < end; ++index) {
+            const double* point = points.row(index);
+            double* lower = m_GroupLowerBounds.data() + index * groupCount;
+            const uint32_t previousLabel = m_Labels[index];
+
+            // shift the bounds by how far the centroids moved, and find the smallest group bound
+            double upper = m_UpperBounds[index] + m_Drift[previousLabel];
+            double globalLower = std::numeric_limits<double>::max();
+            for (size_t group = 0; group < groupCount; ++group) {
+                previousLower[group] = lower[group];
+                lower[group] = std::max(0.0, lower[group] - m_GroupDrift[group]);
+                globalLower = std::min(globalLower, lower[group]);
+            }
+
+            // global filter: nothing in any group can beat the current centroid
+            if (upper <= globalLower) {
+                m_UpperBounds[index] = upper;
+                sums.accumulate(previousLabel, point);
+                continue;
+            }
+
+            // tighten the upper bound, and try the global filter once more
+            const double previousLabelDistance = std::sqrt(kernel::squaredEuclideanDistance(point, centroids.row(previousLabel), numDimensions));
+            ++evaluations;
+            if (previousLabelDistance <= globalLower) {
+                m_UpperBounds[index] = previousLabelDistance;
+                sums.accumulate(previousLabel, point);
+                continue;
+            }
+
+            // group filter: only open the groups whose bound is under the best distance found so far
+            double best = previousLabelDistance;
+            uint32_t label = previousLabel;
+            for (size_t group = 0; group < groupCount; ++group) {
+                groupOpened[group] = lower[group] < best;
+                if (!groupOpened[group]) {
+                    continue;
+                }
+
+                double closest = std::numeric_limits<double>::max();
+                double secondClosest = std::numeric_limits<double>::max();
+                uint32_t closestIndex = std::numeric_limits<uint32_t>::max();
+                for (const uint32_t centroid : m_GroupMembers[group]) {
+                    double value;
+                    if (centroid == previousLabel) {
+                        value = previousLabelDistance;
+                    } else if (const double localBound = previousLower[group] - m_Drift[centroid]; localBound >= best) {
+                        // local filter: this centroid's own drift already rules it out, so its bound stands in for it
+                        value = localBound;
+                    } else {
+                        value = std::sqrt(kernel::squaredEuclideanDistance(point, centroids.row(centroid), numDimensions));
+                        ++evaluations;
+                        if (value < best) {
+                            best = value;
+                            label = centroid;
+                        }
+                    }
+
+                    if (value < closest) {
+                        secondClosest = closest;
+                        closest = value;
+                        closestIndex = centroid;
+                    } else if (value < secondClosest) {
+                        secondClosest = value;
+                    }
+                }
+
+                groupClosest[group] = closest;
+                groupSecondClosest[group] = secondClosest;
+                groupClosestIndex[group] = closestIndex;
+            }
+
+            // every opened group now knows (a bound on) each of its members, so its new bound is its closest member
+            // that isn't the point's final centroid
+            for (size_t group = 0; group < groupCount; ++group) {
+                if (groupOpened[group]) {
+                    lower[group] = (groupClosestIndex[group] == label) ? groupSecondClosest[group] : groupClosest[group];
+                }
+            }
+
+            // if the point left a centroid whose group was never opened, that centroid now counts toward its group's bound
+            if (label != previousLabel && !groupOpened[m_CentroidGroup[previousLabel]]) {
+                double &previousGroupLower = lower[m_CentroidGroup[previousLabel]];
+                previousGroupLower = std::min(previousGroupLower, previousLabelDistance);
+            }
+
+            m_Labels[index] = label;
+            m_UpperBounds[index] = best;
+            sums.accumulate(label, point);
+        }
+
+        m_DistanceEvaluations.fetch_add(evaluations, std::memory_order_relaxed);
+    }
+
+} // kmeans
@@ -0,0 +1,96 @@
+//
+// Created by Matthew Krueger on 10/29/25.
+//
+
+#ifndef KMEANS_MPI_YINYANGASSIGNMENT_HPP
+#define KMEANS_MPI_YINYANGASSIGNMENT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AssignmentEngine.hpp"
+#include "PointMatrix.hpp"
+
+namespace kmeans {
+
+    /**
+     * @brief An exact assignment engine for large k that bounds GROUPS of centroids (Yinyang k-means, Ding et al. 2015).
+     *
+     * On the first iteration the centroids are clustered into t groups (a few rounds of k-means over the centroids
+     * themselves), and the groups are fixed from then on. Every point keeps an upper bound on the distance to its
+     * centroid, and one lower bound per group, on the distance to any centroid in that group other than its own.
+     *
+     * Each iteration then filters in two stages:
+     * - Global: if the upper bound is under the smallest group lower bound, the point cannot have moved.
+     * - Group: otherwise, only the groups whose lower bound is under the upper bound are opened, and inside an opened
+     *   group, centroids whose own drift already rules them out are skipped too (local filtering).
+     * Only what survives both gets an exact distance.
+     *
+     * Memory is O(n * t), so t sits between Hamerly (t = 1) and Elkan (t = k). The default is k / 10, as in the paper.
+     *
+     * The labels it produces are the same as Lloyd's, up to ties between equidistant centroids.
+     */
+    class YinyangAssignmentEngine final : public AssignmentEngine {
+    public:
+        /**
+         * @param groupCount The number of centroid groups (t). Zero picks k / 10. Clamped to [1, k].
+         */
+        explicit YinyangAssignmentEngine(size_t groupCount = 0) : m_RequestedGroupCount(groupCount) {}
+
+        void prepare(const PointMatrix& points, const CentroidMatrix& centroids) override;
+        void assign(const PointMatrix& points, const CentroidMatrix& centroids, size_t begin, size_t end, CentroidMatrix& sums) override;
+
+        /**
+         * @brief Gets the number of point to centroid distances actually evaluated since the engine was created.
+         */
+        [[nodiscard]] inline uint64_t getDistanceEvaluations() const { return m_DistanceEvaluations.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Gets the number of groups actually in use. Only meaningful after the first prepare().
+         */
+        [[nodiscard]] inline size_t getGroupCount() const { return m_GroupMembers.size(); }
+
+    private:
+        /**
+         * @brief Clusters the centroids into groups with a few rounds of k-means over the centroids themselves.
+         */
+        void formGroups(const CentroidMatrix& centroids);
+
+        void initializeRows(const PointMatrix& points, const CentroidMatrix& centroids, size_t begin, size_t end, CentroidMatrix& sums);
+
+        /// How many rounds of k-means are spent grouping the centroids. The paper uses five.
+        static constexpr size_t GROUPING_ITERATIONS = 5;
+
+        size_t m_RequestedGroupCount;
+        size_t m_NumPoints = 0;
+        size_t m_NumCentroids = 0;
+        const double* m_PointsSource = nullptr;
+        /// Whether this iteration has to build the bounds from scratch (first iteration, or new points)
+        bool m_Initializing = true;
+
+        /// The centroid indices in each group
+        std::vector<std::vector<uint32_t>> m_GroupMembers;
+        /// The group each centroid belongs to
+        std::vector<uint32_t> m_CentroidGroup;
+
+        std::vector<uint32_t> m_Labels;
+        /// Upper bound on the distance from each point to its assigned centroid
+        std::vector<double> m_UpperBounds;
+        /// n * t lower bounds, row-major by point
+        std::vector<double> m_GroupLowerBounds;
+
+        /// The centroids the bounds are currently relative to, so we can measure how far each one moved
+        AlignedDoubleVector m_LastCentroids;
+        /// How far each centroid moved since the previous iteration
+        std::vector<double> m_Drift;
+        /// The largest drift in each group
+        std::vector<double> m_GroupDrift;
+
+        std::atomic<uint64_t> m_DistanceEvaluations = 0;
+    };
+
+} // kmeans
+
+#endif //KMEANS_MPI_YINYANGASSIGNMENT_HPP
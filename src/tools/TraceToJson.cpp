@@ -0,0 +1,27 @@
+//
+// Created by Matthew Krueger on 11/9/25.
+//
+
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include "../shared/TraceFormat.hpp"
+
+int main(const int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <trace file or shard>... <output json>" << std::endl;
+        return 1;
+    }
+
+    // any number of traces, e.g. every rank's shard, all end up in the one Chrome trace
+    const std::vector<std::filesystem::path> tracePaths(argv + 1, argv + argc - 1);
+    try {
+        instrumentation::convertTraceToChromeJson(tracePaths, argv[argc - 1]);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}